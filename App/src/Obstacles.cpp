@@ -18,49 +18,55 @@ void setupObstacles(f32 gapOffset)
 {
     vec2 windowSize = Velox::getWindowSize();
 
-    Velox::Entity* top = Velox::getEntityManager()->getCreateEntity();
-    Velox::Entity* bot = Velox::getEntityManager()->getCreateEntity();
-
-    top->type = EntityType::Spike;
-    bot->type = EntityType::Spike;
-
     f32 spikeSize = (windowSize.y / 2.0f) + s_offsetMax - (s_gapSize / 2.0f) + 5.0f;
     f32 midPoint  = (windowSize.y / 2.0f) + gapOffset;
 
-    top->scale = vec2(spikeSize / 8.0f, spikeSize);
-    bot->scale = vec2(spikeSize / 8.0f, spikeSize);
-
-    top->position = vec3(windowSize.x + 30.0f, midPoint + (s_gapSize / 2.0f) + 5.0f, 0.0f);
+    Velox::Texture* texture = Velox::getAssetManager()->loadTexture("rock_ice.png");
 
-    bot->position = vec3(windowSize.x + 30.0f, midPoint - spikeSize - (s_gapSize / 2.0f)- 0.5, 0.0f);
-    bot->rotation = 180.0f;  // upside down.
+    // Called from the spawners update, so queue them up rather than touching the hierarchy mid-update.
+    Velox::EntityCommandBuffer& commands = Velox::getEntityManager()->commands();
 
-    top->texture = Velox::getAssetManager()->loadTexture("rock_ice.png");
-    bot->texture = Velox::getAssetManager()->getTexture("rock_ice.png");
-
-    top->setFlag(Velox::EntityFlags::Visible,  true);
-    bot->setFlag(Velox::EntityFlags::Visible,  true);
+    auto setupSpike = [spikeSize, texture](Velox::Entity& e)
+    {
+        e.type = EntityType::Spike;
+        e.scaleMut() = vec2(spikeSize / 8.0f, spikeSize);
+        e.render().texture = texture;
+        e.setFlag(Velox::EntityFlags::Visible, true);
+        e.updateFunction = updateObstacles;
+    };
+
+    Velox::EntityHandle top = commands.createEntity({}, [=](Velox::Entity& e)
+    {
+        setupSpike(e);
+        e.positionMut() = vec3(windowSize.x + 30.0f, midPoint + (s_gapSize / 2.0f) + 5.0f, 0.0f);
+    });
 
-    top->updateFunction = updateObstacles;
-    bot->updateFunction = updateObstacles;
+    Velox::EntityHandle bot = commands.createEntity({}, [=](Velox::Entity& e)
+    {
+        setupSpike(e);
+        e.positionMut() = vec3(windowSize.x + 30.0f, midPoint - spikeSize - (s_gapSize / 2.0f)- 0.5, 0.0f);
+        e.rotationMut() = 180.0f;  // upside down.
+    });
 
     // Use child entities for colliders.
-    Velox::Entity* topCollider = Velox::getEntityManager()->getCreateEntity(top->id);
-    Velox::Entity* botCollider = Velox::getEntityManager()->getCreateEntity(bot->id);
-
-    topCollider->position.x = 80.0f;
-    botCollider->position.x = -45.0f;
-
-    topCollider->scale.x = 0.2f;
-    botCollider->scale.x = 0.2f;
+    commands.createEntity(top, [](Velox::Entity& e)
+    {
+        e.positionMut().x = 80.0f;
+        e.scaleMut().x = 0.2f;
+        e.setFlag(Velox::EntityFlags::Collides, true);
+    });
 
-    topCollider->setFlag(Velox::EntityFlags::Collides, true);
-    botCollider->setFlag(Velox::EntityFlags::Collides, true);
+    commands.createEntity(bot, [](Velox::Entity& e)
+    {
+        e.positionMut().x = -45.0f;
+        e.scaleMut().x = 0.2f;
+        e.setFlag(Velox::EntityFlags::Collides, true);
+    });
 }
 
 void updateObstacles(Velox::Entity& e, const double& deltaTime)
 {
-    if (e.position.x + e.scale.x < 0)
+    if (e.position().x + e.scale().x < 0)
     {
         Velox::getEntityManager()->destroyEntity(e.id);
         return;
@@ -68,17 +74,17 @@ void updateObstacles(Velox::Entity& e, const double& deltaTime)
 
     // Bit jank, but just use the top spike to register points, need better
     // entity system...
-    if (e.position.y < 0.0f)
+    if (e.position().y < 0.0f)
     {
         float planeXPosition = 200.0f;
-        if (e.position.x < planeXPosition && s_lastScoringID != e.id)
+        if (e.position().x < planeXPosition && s_lastScoringID != e.id)
         {
             s_lastScoringID = e.id;
             getGameState()->score += 1;
         }
     }
 
-    e.position.x -= getGameState()->scrollSpeed * deltaTime;
+    e.positionMut().x -= getGameState()->scrollSpeed * deltaTime;
 }
 
 void setupSpawner()
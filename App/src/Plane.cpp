@@ -18,11 +18,11 @@ void setupPlane()
     Velox::Entity* e = Velox::getEntityManager()->getCreateEntity();
     e->type = EntityType::Plane;
      
-    e->position.x = 200;
-    e->position.y = Velox::getWindowSize().y / 2.0f;
+    e->positionMut().x = 200;
+    e->positionMut().y = Velox::getWindowSize().y / 2.0f;
 
-    e->texture = Velox::getAssetManager()->loadTexture("plane_red_1.png");
-    e->scale = vec2(200.0f, 200.0f);
+    e->render().texture = Velox::getAssetManager()->loadTexture("plane_red_1.png");
+    e->scaleMut() = vec2(200.0f, 200.0f);
 
     e->setFlag(Velox::EntityFlags::Visible,  true);
     e->setFlag(Velox::EntityFlags::Collides, true);
@@ -37,18 +37,20 @@ void updatePlane(Velox::Entity& e, const double& deltaTime)
     float windowHeight = Velox::getWindowSize().y;
 
     // Lose if plane falls out of bounds.
-    if (e.position.y > windowHeight - (e.scale.y * 0.5))
+    if (e.position().y > windowHeight - (e.scale().y * 0.5))
     {
         changeGameStage(GameStage::PostRound);
         return;
     }
 
     // Block input if too high up (out of bounds).
-    if (Velox::isKeyPressed(SDL_SCANCODE_SPACE) && e.position.y < windowHeight)
+    if (Velox::isKeyPressed(SDL_SCANCODE_SPACE) && e.position().y < windowHeight)
         s_verticalVelocity = JUMP_IMPULSE_FORCE;
 
     // Check for collisions.
-    std::vector<Velox::EntityHandle> overlaps = e.getOverlappingEntities();
+    static std::vector<Velox::EntityHandle> overlaps;
+    overlaps.clear();
+    e.getOverlappingEntities(&overlaps);
 
     // Currenly anything that would overlap would kill the plane.
     if (overlaps.size() > 0)
@@ -58,10 +60,10 @@ void updatePlane(Velox::Entity& e, const double& deltaTime)
     }
 
     s_verticalVelocity -= GRAVITY_FACTOR * deltaTime;
-    e.position.y -= s_verticalVelocity;
+    e.positionMut().y -= s_verticalVelocity;
 
     // update orientation
     vec2 pointDirection = vec2(getGameState()->scrollSpeed, s_verticalVelocity);
-    e.rotation = (glm::atan(pointDirection.y, pointDirection.x) / glm::pi<float>()) * 180.0;
+    e.rotationMut() = (glm::atan(pointDirection.y, pointDirection.x) / glm::pi<float>()) * 180.0;
 }
 
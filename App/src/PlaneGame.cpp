@@ -58,7 +58,7 @@ void doPlaneGameUpdates(const double& deltaTime)
     if (s_gameState.gameStage != GameStage::Simulation)
         return;
 
-    Velox::getEntityManager()->treeView.updateEntities(deltaTime);
+    Velox::getEntityManager()->updateEntities(deltaTime);
 }
 
 void drawPlaneGame()
@@ -12,13 +12,15 @@ Velox::EntityHandle createBackgroundEntity(float initialXPosition)
 {
     Velox::Entity* e = Velox::getEntityManager()->getCreateEntity();
      
-    e->position.x = initialXPosition;
+    e->positionMut().x = initialXPosition;
+    // Behind everything else, draws are sorted by depth before texture.
+    e->positionMut().z = -0.5f;
 
-    e->texture = Velox::getAssetManager()->loadTexture("background.png");
-    e->scale = Velox::getWindowSize();
+    e->render().texture = Velox::getAssetManager()->loadTexture("background.png");
+    e->scaleMut() = Velox::getWindowSize();
 
     // Add a small amount of overlap to avoid pixel gaps between backgrounds.
-    e->scale.x += 1.0f;
+    e->scaleMut().x += 1.0f;
 
     e->setFlag(Velox::EntityFlags::Visible,  true);
     e->setFlag(Velox::EntityFlags::Visible,  true);
@@ -38,8 +40,8 @@ void updateScrollingBackground(Velox::Entity& e, const double& deltaTime)
 {
     // Substract 1 as it is only intended to be overlap, not actual size for calculations.
     // See comment in setup.
-    if (e.position.x + e.scale.x - 1.0f <= 0.0f)
-        e.position.x += (e.scale.x - 1.0f) * 2.0f;
+    if (e.position().x + e.scale().x - 1.0f <= 0.0f)
+        e.positionMut().x += (e.scale().x - 1.0f) * 2.0f;
 
-    e.position.x -= (getGameState()->scrollSpeed / 2.0f) * deltaTime;
+    e.positionMut().x -= (getGameState()->scrollSpeed / 2.0f) * deltaTime;
 }
@@ -28,12 +28,23 @@ struct VELOX_API Font {
     Velox::Texture* texture;
 };
 
+constexpr i32 TEXTURE_ATLAS_PAGE_SIZE = 2048;
+
+// Shared texture small textures get packed into as they're loaded, see Config::atlasMaxTextureSize.
+struct TextureAtlasPage {
+    u32 id;
+    msdf_atlas::RectanglePacker packer;
+    u64 usedPixels = 0; // Including padding.
+};
+
 struct VELOX_API AssetManager {
     // Textures are stored in the renderer
     std::unordered_map<const char*, Velox::Texture> textureMap = {};
     std::unordered_map<const char*, Velox::ShaderProgram> shaderProgramMap = {};
     std::unordered_map<const char*, Velox::Font> fontMap = {};
 
+    std::vector<Velox::TextureAtlasPage> atlasPages = {};
+
     Velox::Texture* loadTexture(const char* filepath);
     Velox::Texture* getTexture(const char* filepath);
 
@@ -55,4 +66,7 @@ void deInitAssets();
 
 VELOX_API void getAssetMemoryUsage(size_t* used, size_t* capacity);
 
+// fillRatio is packed pixels over the total area of all pages, 0 without pages.
+VELOX_API void getTextureAtlasUsage(u32* pageCount, u32* textureCount, f32* fillRatio);
+
 }
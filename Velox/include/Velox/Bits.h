@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Velox.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> // _BitScanForward64
+#endif
+
+namespace Velox {
+
+// Undefined for 0.
+inline u32 countTrailingZeros(u64 bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<u32>(index);
+#else
+    return static_cast<u32>(__builtin_ctzll(bits));
+#endif
+}
+
+inline u32 countSetBits(u64 bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<u32>(__popcnt64(bits));
+#else
+    return static_cast<u32>(__builtin_popcountll(bits));
+#endif
+}
+
+}
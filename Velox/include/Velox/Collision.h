@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Velox.h>
+
+#include <utility>  // pair
+
+namespace Velox {
+
+// Rectangles as separate min/max columns, the layout the batch overlap kernels want.
+struct VELOX_API RectangleBounds {
+    std::vector<float> minX, minY, maxX, maxY;
+
+    void assign(const Velox::Rectangle* rects, u32 count);
+    u32 size() const { return static_cast<u32>(minX.size()); }
+};
+
+enum OverlapKernel {
+    OverlapKernel_Scalar,
+    OverlapKernel_SSE,
+    OverlapKernel_AVX2,
+    OverlapKernel_COUNT,
+};
+
+// Batch versions of Velox::isOverlapping(), same results. Implementation is picked at runtime
+// from what the CPU supports, see setOverlapKernel().
+//
+// Bit i of mask[i / 64] is set when rect overlaps rectangle i, needs (size + 63) / 64 words.
+VELOX_API void overlapMask(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u64* mask);
+// Writes the indices of rectangles overlapping rect, needs room for bounds.size(). Returns the hit count.
+VELOX_API u32 overlapIndices(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u32* hits);
+// Narrowphase over broadphase candidates. Keeps the pairs (first[i], second[i]) that overlap by
+// moving them to the front of both arrays, returns how many were kept.
+VELOX_API u32 overlapPairs(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 count);
+
+// Returns false (and keeps the current one) if the CPU doesn't support it.
+VELOX_API bool setOverlapKernel(OverlapKernel kernel);
+VELOX_API OverlapKernel getOverlapKernel();
+VELOX_API const char* getOverlapKernelName(OverlapKernel kernel);
+
+// Broadphase over a flat array of rectangles, rebuilt from scratch once per tick.
+// Knows nothing about entities, results are indices into the rectangles passed to build().
+//
+// Uniform grid where cells are hashed into a fixed number of buckets, so the world doesn't
+// need bounds. Buckets are stored packed (counting sort), a rectangle is recorded in every
+// cell it touches. Duplicates are avoided by only reporting a hit from the cell containing
+// the min corner of the two rectangles' intersection.
+struct VELOX_API CollisionGrid {
+    // Record of a rectangle in one cell. Cell is kept so hash collisions can be told apart.
+    struct Record {
+        u32 rect;
+        i32 cellX, cellY;
+    };
+
+    // <= 0 picks a size from the average rectangle size on every build.
+    float cellSize = 0.0f;
+    // Rectangles touching more cells than this skip the grid and get tested against everything.
+    u32 maxCellsPerRect = 64;
+
+    float usedCellSize    = 1.0f;
+    float inverseCellSize = 1.0f;
+    u32   bucketMask      = 0;
+
+    const Velox::Rectangle* rects = nullptr;
+    u32 rectCount = 0;
+    Velox::RectangleBounds bounds {};
+
+    std::vector<u32>    bucketStarts; // bucketMask + 2 entries, records of bucket b are [starts[b], starts[b + 1]).
+    std::vector<Record> records;
+    std::vector<u32>    oversized;
+
+    // rects must stay valid until the next build.
+    void build(const Velox::Rectangle* rects, u32 count);
+
+    // Appends indices of rectangles overlapping rect, skipping ignore (if given).
+    void query(const Velox::Rectangle& rect, std::vector<u32>* hits, u32 ignore = UINT32_MAX) const;
+
+    // Appends every overlapping pair once, with first < second.
+    void queryPairs(std::vector<std::pair<u32, u32>>* pairs) const;
+
+    u32 bucketOf(i32 cellX, i32 cellY) const;
+    void cellOf(float x, float y, i32* cellX, i32* cellY) const;
+};
+
+}
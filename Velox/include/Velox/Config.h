@@ -8,6 +8,9 @@ struct VELOX_API Config {
     int windowWidth = 1920;
     int windowHeight = 1080;
     int vsyncMode = 1;
+    int atlasMaxTextureSize = 256; // Textures up to this size (both sides) are packed into atlas pages, 0 disables.
+    bool renderThread = false; // Submit and swap on a thread of their own, read once at startup.
+    int framesInFlight = 2;    // Frames the main thread can get ahead of the render thread, 1 to 3.
 };
 
 VELOX_API Config* getConfig();
@@ -18,6 +18,7 @@ void entityCommand(std::string& response, const std::vector<std::string> args);
 void colliderCommand(std::string& response, const std::vector<std::string> args);
 void eventSubscribersCommand(std::string& response, const std::vector<std::string> args);
 void debugText(std::string& response, const std::vector<std::string> args);
+void spriteBenchmarkCommand(std::string& response, const std::vector<std::string> args);
 void quitCommand(std::string& response, const std::vector<std::string> args);
 
 }
@@ -13,6 +13,8 @@ struct VELOX_API EngineState {
     bool showEntityInfo       = false;
     bool drawColliders        = false;
     bool drawTextLines        = false;
+
+    u32  spriteBenchmarkCount = 0; // Sprites drawn per frame by the sprite benchmark, 0 is off.
 };
 
 // GM: Sets up all framework systems.
@@ -16,6 +16,8 @@ void drawEntityColliders();
 
 void drawEntityHierarchyInfo();
 
+void drawSpriteBenchmark(u32 spriteCount);
+
 VELOX_API void textStyleEditor(Velox::TextDrawStyle* style, bool useCurrentAsBase = false);
 
 void floatScalerWidget(f32* value, const f32& min = 0.0f, const f32& max = 1.0f);
@@ -2,22 +2,51 @@
 
 #include <Velox.h>
 
+#include "Bits.h"
+#include "Collision.h"
+
 #include <utility>  // pair
 
-constexpr size_t MAX_ENTITIES = 1024;
+// Entities are stored in fixed size chunks that are allocated on demand, so existing entities
+// never move and an empty manager costs next to nothing.
+constexpr u32    ENTITY_CHUNK_SHIFT = 10;
+constexpr u32    ENTITY_CHUNK_SIZE  = 1 << ENTITY_CHUNK_SHIFT;
+constexpr u32    ENTITY_CHUNK_MASK  = ENTITY_CHUNK_SIZE - 1;
+constexpr u32    MAX_ENTITY_CHUNKS  = 512;
+constexpr size_t MAX_ENTITIES       = ENTITY_CHUNK_SIZE * MAX_ENTITY_CHUNKS;
+// Alive bits are packed 64 to a word.
+constexpr u32    ENTITY_ALIVE_WORDS = ENTITY_CHUNK_SIZE / 64;
+
+constexpr u32    HIERARCHY_NONE     = UINT32_MAX;
+// Generation of the placeholder handles returned by EntityCommandBuffer::createEntity().
+constexpr u32    ENTITY_PENDING_GENERATION = UINT32_MAX;
 
 namespace Velox {
 
 struct Texture;
+struct DrawList;
 struct EntityManager;
 
 enum EntityFlags : uint32_t {
     None     = 0,
     Updates  = 1 << 0,
     Visible  = 1 << 1,
-    Static   = 1 << 2,
+    Static   = 1 << 2, // Stays put when its parent moves, see EntityManager::updateTransforms().
     Collides = 1 << 3,
     Dead     = 1 << 4,
+
+    CollideFromCenter = 1 << 5,
+    DrawFromCenter    = 1 << 6,
+
+    // Managed by the transform accessors, see EntityManager::markTransformDirty().
+    TransformDirty    = 1 << 7,
+    SubtreeDirty      = 1 << 8, // Some descendant has TransformDirty set.
+
+    // On a top level entity: its update function, and those of its children, only touch the
+    // subtree itself so it can be updated on a worker thread. See EntityManager::parallelUpdates.
+    ThreadSafe        = 1 << 9,
+    // Its draw function only draws, so it can run on a worker thread. See EntityManager::parallelDraws.
+    ThreadSafeDraw    = 1 << 10,
 };
 
 struct VELOX_API EntityHandle {
@@ -39,10 +68,23 @@ struct VELOX_API EntityHandle {
 void initEntitySystem();
 VELOX_API Velox::EntityManager* getEntityManager();
 
+// Written as a unit by transform propagation, so stored together.
+struct VELOX_API EntityTransform {
+    vec3  position = vec3(0.0f);
+    float rotation = 0;
+    vec2  scale    = vec2(1.0f);
+};
+
+struct VELOX_API EntityRenderData {
+    Velox::Texture* texture = nullptr;
+    vec4 colorTint = vec4(1.0f); // colors aren't clamped so can use for flashe effects for example.
+};
+
+// Cold per-entity data. Anything touched by the hot per-tick loops (transforms, colliders, flags,
+// render data) lives in the EntityManager columns and is reached through the accessors below.
 struct VELOX_API Entity {
     // Core
     EntityHandle id;
-    u32 flags = Velox::EntityFlags::Updates;
     u32 type = 0;
 
     // Functions
@@ -51,112 +93,292 @@ struct VELOX_API Entity {
 
     EntityHandle parent = {};
 
+    Velox::EntityManager* manager = nullptr;
+
+    // Column accessors.
+    u32& flags();
+
     // Transform
-    // Usually you want to write these.
-    vec3  position = vec3(0.0f);
-    float rotation = 0;
-    vec2  scale    = vec4(1.0f);
+    // The Mut versions mark the transform dirty, reading doesn't.
+    vec3&  positionMut();
+    float& rotationMut();
+    vec2&  scaleMut();
+
+    const vec3&  position() const;
+    const float& rotation() const;
+    const vec2&  scale()    const;
+
+    void markTransformDirty();
 
-    // Usually you only want to read these.
-    vec3  absolutePosition = vec3(0.0f);
-    float absoluteRotation = 0;
-    vec2  absoluteScale    = vec4(1.0f);
+    // Usually you only want to read this.
+    const Velox::EntityTransform& absolute() const;
 
     // Collision
-    bool collideFromCenter = false;
-    Velox::Rectangle collider = { 0.0f, 0.0f, scale.x, scale.y };
+    Velox::Rectangle& collider();
 
     // Rendering
-    Velox::Texture* texture = nullptr;
-    bool drawFromCenter = false;
-    vec4 colorTint = vec4(1.0f); // colors aren't clamped so can use for flashe effects for example.
-
-    bool hasFlag(EntityFlags flag) const
-    {   
-        return (flags & flag) != 0;
-    }
+    Velox::EntityRenderData& render();
 
-    void setFlag(EntityFlags flag, int state)
-    {
-        if (state) flags |=  flag;
-        else       flags &= ~flag;
-    }
+    bool hasFlag(EntityFlags flag) const;
+    void setFlag(EntityFlags flag, int state);
 
-    // Quality of life/reminder that entity tree view needs to be updated to act on
-    // parent/child relationships. See comment on EntityManager::generateTreeView().
+    // Moves this entity, along with its children, under handle. Invalid handle moves it to the top level.
     void setParent(const EntityHandle& handle);
 
     // Only for calling update/draw function members.
     void update(const double& deltaTime);
-    // Speeds up hierarchical iteration slightly (probably).
-    void update(const double& deltaTime, Entity* parentRef);
     void draw();
+
+    // Against the broadphase built at the start of this tick, see EntityManager::updateBroadphase().
+    void getOverlappingEntities(std::vector<Velox::EntityHandle>* overlaps);
     std::vector<Velox::EntityHandle> getOverlappingEntities();
 };
 
-struct VELOX_API EntityNode {
-    Velox::EntityHandle id {};
-    std::vector<EntityNode> children;
+enum class EntityCommandType : u32 {
+    Create,
+    Destroy,
+    SetParent,
+    SetFlag,
+};
 
-    bool isLeaf();
-    bool addNode(const Velox::EntityNode& node, const Velox::EntityNode& desiredParent);
-    void update(const double& deltaTime, Velox::Entity* parent = nullptr, bool isRoot = false);
-    void destroyChildren(const EntityHandle& handle, bool isRoot = false);
+struct VELOX_API EntityCommand {
+    Velox::EntityCommandType type;
+    EntityHandle handle {};
+    EntityHandle parent {};
+    u32 flag  = 0;
+    int state = 0;
+    std::function<void(Velox::Entity&)> onCreate = nullptr;
 };
 
-struct VELOX_API EntityTreeView {
-    EntityNode root {};
+// Structural changes recorded while the hierarchy can't (or shouldn't) be touched, applied
+// together by EntityManager::applyCommands(). All creates go in first as one batch, then
+// onCreate callbacks run, then the remaining commands in the order they were recorded.
+struct VELOX_API EntityCommandBuffer {
+    std::vector<Velox::EntityCommand> commands;
 
-    bool addNode(const EntityHandle& node, const EntityHandle& desiredParent = {});
-    // void removeNode(EntityHandle& handle);
-    void updateEntities(const double& deltaTime);
+    // Returns a placeholder handle that the other commands in this buffer (including creates,
+    // as parent) accept. It means nothing anywhere else, setup goes in onCreate.
+    EntityHandle createEntity(const EntityHandle& parent = {}, std::function<void(Velox::Entity&)> onCreate = nullptr);
+    void destroyEntity(const EntityHandle& handle);
+    void setParent(const EntityHandle& handle, const EntityHandle& parent);
+    void setFlag(const EntityHandle& handle, EntityFlags flag, int state);
+
+    bool empty() const { return commands.empty(); }
+    void clear() { commands.clear(); }
+};
+
+// One entry of the flattened hierarchy. Entries are kept in depth first order, so parents always
+// come before their children and a subtree is the contiguous range [position, position + subtreeSize).
+struct VELOX_API EntityHierarchyEntry {
+    EntityHandle handle {};
+    u32 parent      = HIERARCHY_NONE; // Position of the parent entry.
+    u32 subtreeSize = 1;              // Including self.
+};
+
+// Subtree to add at the end of the subtree at parentPosition, see EntityManager::insertIntoHierarchy().
+struct VELOX_API EntityHierarchyInsert {
+    u32 parentPosition = HIERARCHY_NONE;
+    u32 first = 0; // Into the entries array, which has parents relative to first.
+    u32 count = 0;
+    u32 at    = 0; // Filled in by the insert.
+};
+
+// One page of entity storage. Component columns are indexed by (EntityHandle::index & ENTITY_CHUNK_MASK)
+// and kept separate so a system only pulls the data it actually reads through cache.
+struct VELOX_API EntityChunk {
+    Entity   entities[ENTITY_CHUNK_SIZE];
+    uint32_t generations[ENTITY_CHUNK_SIZE];
+    // Bit per slot, set while the slot holds a live entity. Lets iteration skip 64 dead slots at a time.
+    u64      alive[ENTITY_ALIVE_WORDS];
+
+    u32                     flags[ENTITY_CHUNK_SIZE];
+    vec3                    positions[ENTITY_CHUNK_SIZE];
+    float                   rotations[ENTITY_CHUNK_SIZE];
+    vec2                    scales[ENTITY_CHUNK_SIZE];
+    Velox::EntityTransform  absoluteTransforms[ENTITY_CHUNK_SIZE];
+    Velox::Rectangle        colliders[ENTITY_CHUNK_SIZE];
+    Velox::EntityRenderData renderData[ENTITY_CHUNK_SIZE];
+
+    u32 hierarchyPositions[ENTITY_CHUNK_SIZE];
 };
 
 // Ideas:
-// Could store entites in arrays that are sorted is dfs or bfs ordering for fast tree traversal. 
-//  - e.g. Insert child entities after parents(in memory) for dfs, not sure what this is called. Flat tree?
-//  - Would have to shuffle indices every insertion/deletion, probably quite fast for less dynamic scenes.
 // Multiple arrays for different ordering, i.e. draw order, tree order, etc.
 struct VELOX_API EntityManager {
-    // GM: Will probably need to use custom allocator for this when entity data gets big enough.
-    Entity entities[MAX_ENTITIES];
-    uint32_t generations[MAX_ENTITIES];
-    uint32_t freeIndices[MAX_ENTITIES];
-    size_t freeIndicesCount = MAX_ENTITIES;
-    Velox::EntityTreeView treeView {};
-    bool isTreeDirty = false;
+    // Page table, only ever appended to so chunk (and Entity*) addresses stay stable.
+    Velox::EntityChunk* chunks[MAX_ENTITY_CHUNKS] = {};
+    u32 chunkCount = 0;
+    std::vector<uint32_t> freeIndices;
+    size_t aliveCount = 0;
+
+    // Parent/child relationships, flattened. Inserts go at the end of the parents subtree so
+    // only entries after it have to shift, which is cheap when children are created with
+    // (or shortly after) their parent.
+    std::vector<Velox::EntityHierarchyEntry> hierarchy;
+    // Set when entries may be stale, see compactHierarchy().
+    bool isHierarchyDirty = false;
+
+    // Number of absolute transforms written by the last updateEntities().
+    u32 transformsRecomputed = 0;
+
+    // Colliders of Collides flagged entities, gathered once per tick.
+    Velox::CollisionGrid collisionGrid {};
+    std::vector<Velox::Rectangle> colliderRects;
+    std::vector<EntityHandle> colliderHandles;
+
+    // Opt-in. Top level subtrees whose root has the ThreadSafe flag get updated concurrently on
+    // the job system, before everything else is updated on the calling thread.
+    bool parallelUpdates = false;
+    // Set during the parallel part of updateEntities(). createEntity() isn't allowed then, and
+    // destroyEntity()/setParent() go through the calling threads command buffer instead.
+    bool isUpdatingInParallel = false;
+
+    // Sprites of entities without a custom draw function are culled against the view before any
+    // vertices are made for them, see cullSprites(). Custom draw functions are always called.
+    bool spriteCulling = true;
+    // Of the last drawEntities().
+    u32 spritesSubmitted = 0;
+    u32 spritesCulled    = 0;
+    // Rotated bounds of every sprite cullSprites() looked at, in index order.
+    Velox::RectangleBounds spriteBounds {};
+    // Bit i is set when sprite i overlaps the view.
+    std::vector<u64> spriteVisibleMask;
+    // Position of each chunk's first sprite in spriteBounds.
+    std::vector<u32> chunkFirstSprite;
+
+    // Opt-in. drawEntities() records each chunk into its own draw list on the job system, then
+    // submits them in chunk order, so the frame is the same as drawing them one by one. Custom
+    // draw functions of entities without the ThreadSafeDraw flag still run on the calling thread.
+    bool parallelDraws = false;
+    // Indexed by chunk.
+    std::vector<Velox::DrawList*> chunkDrawLists;
+    // Entities to draw on the calling thread, with the draw list size at the point they come in.
+    std::vector<std::vector<std::pair<u32, EntityHandle>>> chunkDeferredDraws;
+
+    // One per job thread, applied in postFrameUpdates().
+    std::vector<Velox::EntityCommandBuffer> threadCommandBuffers;
+
+    // Scratch buffers, kept around to avoid allocating every frame.
+    std::vector<Velox::EntityHierarchyEntry> hierarchyScratch;
+    std::vector<uint32_t> hierarchyRemap;
+    std::vector<EntityHandle> updateOrder;
+    std::vector<uint32_t> parallelRoots; // Hierarchy positions.
+    std::vector<u8> transformWritten; // Per hierarchy position, by the running updateTransforms().
+    std::vector<Velox::EntityCommand> pendingCommands;
+    std::vector<EntityHandle> commandHandles;
+    std::vector<Velox::EntityHierarchyEntry> insertEntries;
+    std::vector<Velox::EntityHierarchyInsert> inserts;
+    std::vector<uint32_t> createFirstChild, createNextSibling, createLastChild;
+    std::vector<std::pair<uint32_t, uint32_t>> createStack;
 
     EntityManager();
+    ~EntityManager();
+
+    EntityManager(const EntityManager&) = delete;
+    EntityManager& operator=(const EntityManager&) = delete;
+
+    // Number of slots backed by allocated chunks.
+    uint32_t capacity() const { return chunkCount * ENTITY_CHUNK_SIZE; }
+
+    Velox::EntityChunk* chunkOf(uint32_t index) const { return chunks[index >> ENTITY_CHUNK_SHIFT]; }
+    u32& hierarchyPositionOf(uint32_t index) { return chunkOf(index)->hierarchyPositions[index & ENTITY_CHUNK_MASK]; }
+
+    bool allocateChunk();
 
     EntityHandle makeHandle(uint32_t index) const;
 
+    // Takes a slot and resets its columns, doesn't touch the hierarchy.
+    EntityHandle allocateEntity();
+
     EntityHandle createEntity(const EntityHandle& parent = {});
     Entity* getCreateEntity(const EntityHandle& parent = {});
 
     Entity& get(EntityHandle handle);
     Entity* getMut(EntityHandle handle);
 
+    // Marks the entity and its children as dead, they are removed in postFrameUpdates().
     void destroyEntity(const EntityHandle& handle);
+    // Frees the slot immediately. Children are cleaned up on the next compactHierarchy().
     void destroyEntityInternal(const EntityHandle& handle);
     void destroyAllEntities();
 
-    void updateEntities(double& deltaTime);
-    void drawEntities();
+    // Order of creation doesn't matter, so children can be created before their parent and
+    // attached later. Invalid parent moves the entity to the top level.
+    void setParent(const EntityHandle& handle, const EntityHandle& parent);
 
+    // Transforms first in one pass over the hierarchy, then the broadphase, then update functions
+    // in hierarchy order (ThreadSafe subtrees first when parallelUpdates is on).
+    void updateEntities(const double& deltaTime);
+    // Only dirty subtrees have their transforms recomputed, clean ones are skipped entirely.
+    // Static entities under a moved parent are clean too, unless they were moved themselves.
+    void updateTransforms();
+    // Culls sprites against the current view, then draws everything visible in index order.
+    void drawEntities();
+    // Visibility pass over the transform columns. view is in world space, see Velox::getViewBounds().
+    void cullSprites(const Velox::Rectangle& view);
+    bool isSpriteVisible(u32 sprite) const { return ((spriteVisibleMask[sprite >> 6] >> (sprite & 63)) & 1) != 0; }
+
+    // Rebuilds the collision grid from the current colliders.
+    void updateBroadphase();
+    // Appends the entities whose colliders overlap rect.
+    void queryOverlaps(const Velox::Rectangle& rect, std::vector<EntityHandle>* overlaps, const EntityHandle& ignore = {});
+    // Appends every overlapping pair of colliders once.
+    void getOverlappingPairs(std::vector<std::pair<EntityHandle, EntityHandle>>* pairs);
+
+    // Command buffer of the calling job thread. Safe from update functions, including parallel ones.
+    Velox::EntityCommandBuffer& commands();
+    // Creates from all buffers are inserted with one pass over the hierarchy (none at all if they
+    // are top level), instead of shifting it once per entity.
+    void applyCommands(Velox::EntityCommandBuffer* buffers, u32 count = 1);
+
+    // Applies the thread command buffers, then compacts the hierarchy if anything died.
     void postFrameUpdates();
 
-    // Currently this needs to be called after adding a parent to an entity when added in any way 
-    // other than on first creation with the optional parent parameter on createEntity().
-    // This is pretty dusty, but hierachy is suprisingly tricky to get right (without blowing up
-    // code complextity). addParent() utility method should be used as a reminder.
-    void generateTreeView(bool forceUpdate = false);
+    // Entries are given with parents relative to the first entry (the subtree root).
+    // Returns the position the subtree was inserted at.
+    u32 insertIntoHierarchy(const Velox::EntityHierarchyEntry* entries, u32 count, u32 parentPosition);
+    // Same for many subtrees at once, in a single pass. Inserts under the same parent keep their order.
+    void insertIntoHierarchy(std::vector<Velox::EntityHierarchyInsert>* inserts, const Velox::EntityHierarchyEntry* entries);
+    // Removed entries are written to removed (if given), with parents relative to the first entry.
+    void removeFromHierarchy(u32 position, u32 count, std::vector<Velox::EntityHierarchyEntry>* removed);
+    // Drops entries of destroyed and dead entities (and their children) in one pass.
+    void compactHierarchy();
 
-    void getTreeViewHandlesAsVector(std::vector<EntityHandle>* handles);
-    void getTreeViewEntitiesAsVector(std::vector<Entity*>* handles);
+    void getHierarchyHandlesAsVector(std::vector<EntityHandle>* handles);
+    void getHierarchyEntitiesAsVector(std::vector<Entity*>* entities);
 
     bool isAlive(const EntityHandle& handle) const;
 
     bool isIndexFree(uint32_t index) const;
+    // First alive index >= index, or capacity() if there are none.
+    uint32_t nextAliveIndex(uint32_t index) const;
+
+    // Writes the absolute transform and collider columns of an entity from its local transform
+    // and its parents absolute transform.
+    void updateTransform(uint32_t index, const Velox::EntityTransform* parentTransform);
+
+    // Flags the entity for recomputation and marks its ancestors with SubtreeDirty so the
+    // propagation pass knows to look inside their subtrees.
+    void markTransformDirty(uint32_t index);
+
+    // Visits every alive slot in index order. fn(EntityChunk* chunk, u32 slot, uint32_t index)
+    template<typename Fn> void forEachAliveSlot(Fn fn);
+    // Same for the slots of one chunk.
+    template<typename Fn> void forEachAliveSlotInChunk(u32 chunkIndex, Fn fn);
+
+    // Column iteration, only touches the columns passed to the callback.
+    // Marks every visited transform dirty, use forEachAbsoluteTransform() for reading.
+    // fn(EntityHandle, vec3& position, float& rotation, vec2& scale)
+    template<typename Fn> void forEachTransform(Fn fn);
+    // fn(EntityHandle, const EntityTransform& absolute)
+    template<typename Fn> void forEachAbsoluteTransform(Fn fn);
+    // Only visits entities with the Collides flag. fn(EntityHandle, const Rectangle& collider)
+    template<typename Fn> void forEachCollider(Fn fn);
+    // Only visits entities with the Visible flag.
+    // fn(EntityHandle, u32 flags, const EntityTransform& absolute, const EntityRenderData& render)
+    template<typename Fn> void forEachRenderable(Fn fn);
+
+    void getMemoryUsage(size_t* used, size_t* capacity) const;
 
     struct EntityIterable;
     EntityIterable iter();
@@ -184,6 +406,159 @@ struct VELOX_API EntityManager::EntityIterable {
     Iterator end();
 };
 
+
+//
+// Inline column access
+//
+
+inline u32& Entity::flags()
+{
+    return manager->chunkOf(id.index)->flags[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline void Entity::markTransformDirty()
+{
+    if (!hasFlag(EntityFlags::TransformDirty))
+        manager->markTransformDirty(id.index);
+}
+
+inline vec3& Entity::positionMut()
+{
+    markTransformDirty();
+    return manager->chunkOf(id.index)->positions[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline float& Entity::rotationMut()
+{
+    markTransformDirty();
+    return manager->chunkOf(id.index)->rotations[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline vec2& Entity::scaleMut()
+{
+    markTransformDirty();
+    return manager->chunkOf(id.index)->scales[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline const vec3& Entity::position() const
+{
+    return manager->chunkOf(id.index)->positions[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline const float& Entity::rotation() const
+{
+    return manager->chunkOf(id.index)->rotations[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline const vec2& Entity::scale() const
+{
+    return manager->chunkOf(id.index)->scales[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline const Velox::EntityTransform& Entity::absolute() const
+{
+    return manager->chunkOf(id.index)->absoluteTransforms[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline Velox::Rectangle& Entity::collider()
+{
+    return manager->chunkOf(id.index)->colliders[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline Velox::EntityRenderData& Entity::render()
+{
+    return manager->chunkOf(id.index)->renderData[id.index & ENTITY_CHUNK_MASK];
+}
+
+inline bool Entity::hasFlag(EntityFlags flag) const
+{   
+    return (manager->chunkOf(id.index)->flags[id.index & ENTITY_CHUNK_MASK] & flag) != 0;
+}
+
+inline void Entity::setFlag(EntityFlags flag, int state)
+{
+    u32& entityFlags = flags();
+
+    if (state) entityFlags |=  flag;
+    else       entityFlags &= ~flag;
+
+    // Changes where the collider sits.
+    if (flag == EntityFlags::CollideFromCenter)
+        markTransformDirty();
+}
+
+template<typename Fn>
+void EntityManager::forEachAliveSlot(Fn fn)
+{
+    for (u32 c = 0; c < chunkCount; c++)
+        forEachAliveSlotInChunk(c, fn);
+}
+
+template<typename Fn>
+void EntityManager::forEachAliveSlotInChunk(u32 chunkIndex, Fn fn)
+{
+    Velox::EntityChunk* chunk = chunks[chunkIndex];
+    const u32 base = chunkIndex * ENTITY_CHUNK_SIZE;
+
+    for (u32 word = 0; word < ENTITY_ALIVE_WORDS; word++)
+    {
+        u64 bits = chunk->alive[word];
+        while (bits != 0)
+        {
+            const u32 slot = word * 64 + countTrailingZeros(bits);
+            bits &= bits - 1; // Clear lowest set bit.
+
+            fn(chunk, slot, base + slot);
+        }
+    }
+}
+
+template<typename Fn>
+void EntityManager::forEachTransform(Fn fn)
+{
+    forEachAliveSlot([&](Velox::EntityChunk* chunk, u32 slot, uint32_t index)
+    {
+        if ((chunk->flags[slot] & EntityFlags::TransformDirty) == 0)
+            markTransformDirty(index);
+
+        fn(EntityHandle { index, chunk->generations[slot] },
+                chunk->positions[slot], chunk->rotations[slot], chunk->scales[slot]);
+    });
+}
+
+template<typename Fn>
+void EntityManager::forEachAbsoluteTransform(Fn fn)
+{
+    forEachAliveSlot([&](Velox::EntityChunk* chunk, u32 slot, uint32_t index)
+    {
+        fn(EntityHandle { index, chunk->generations[slot] }, chunk->absoluteTransforms[slot]);
+    });
+}
+
+template<typename Fn>
+void EntityManager::forEachCollider(Fn fn)
+{
+    forEachAliveSlot([&](Velox::EntityChunk* chunk, u32 slot, uint32_t index)
+    {
+        if ((chunk->flags[slot] & EntityFlags::Collides) == 0)
+            return;
+
+        fn(EntityHandle { index, chunk->generations[slot] }, chunk->colliders[slot]);
+    });
+}
+
+template<typename Fn>
+void EntityManager::forEachRenderable(Fn fn)
+{
+    forEachAliveSlot([&](Velox::EntityChunk* chunk, u32 slot, uint32_t index)
+    {
+        if ((chunk->flags[slot] & EntityFlags::Visible) == 0)
+            return;
+
+        fn(EntityHandle { index, chunk->generations[slot] },
+                chunk->flags[slot], chunk->absoluteTransforms[slot], chunk->renderData[slot]);
+    });
+}
 }
 
 // Has to be outside of Velox namespace.
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Velox.h>
+
+#include <atomic>
+#include <functional>
+
+namespace Velox {
+
+// Number of jobs still to finish. Pass one to runJob() to wait on a group of jobs, or
+// to runJobAfter() to make jobs depend on them.
+struct VELOX_API JobCounter {
+    std::atomic<u32> value { 0 };
+
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+struct JobStats {
+    u64 executed = 0; // Jobs run by this thread.
+    u64 stolen   = 0; // Of those, how many were taken from another thread's queue.
+};
+
+// Fixed pool of worker threads, each with its own job queue. A thread pushes and pops
+// its own queue from the back and steals from the front of others when it runs dry.
+// The calling (main) thread is thread 0 and only runs jobs while waiting on a counter.
+//
+// workerCount < 0 picks hardware threads - 1, so main + workers fills the CPU. With 0 workers
+// everything runs on the thread that waits.
+VELOX_API void initJobSystem(i32 workerCount = -1);
+// Waits for queued jobs to finish and joins the workers.
+VELOX_API void deInitJobSystem();
+
+// Worker threads + the main thread.
+VELOX_API u32 getJobThreadCount();
+// 0 on the main thread (and any thread the job system didn't create), 1..n on workers.
+// Stable for the life of the pool, made for indexing per thread buffers.
+VELOX_API u32 getJobThreadIndex();
+
+// counter (if given) is incremented now and decremented once the job has run.
+VELOX_API void runJob(std::function<void()> job, Velox::JobCounter* counter = nullptr);
+// Like runJob(), but the job doesn't start before dependency reaches 0.
+VELOX_API void runJobAfter(Velox::JobCounter* dependency, std::function<void()> job, Velox::JobCounter* counter = nullptr);
+// Runs queued jobs until counter reaches 0, so it's fine to call from inside a job.
+VELOX_API void waitForCounter(Velox::JobCounter* counter);
+
+// Calls function(batchBegin, batchEnd) over [begin, end) in batches of batchSize and waits
+// for all of them. Runs inline when there's only one batch or no workers.
+VELOX_API void parallelFor(u32 begin, u32 end, u32 batchSize, const std::function<void(u32, u32)>& function);
+
+VELOX_API Velox::JobStats getJobStats(u32 threadIndex);
+VELOX_API void resetJobStats();
+
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Velox.h>
+
+#include "glad/gl.h"
+
+namespace Velox {
+
+constexpr u32 GL_STATE_TEXTURE_UNITS   = 32;
+constexpr u32 GL_STATE_BUFFER_BINDINGS = 8; // Per indexed target, uniform and shader storage.
+
+// Unknown, the next set always goes through.
+constexpr u32 GL_STATE_UNKNOWN = UINT32_MAX;
+
+// Shadow of the GL state the renderer sets, calls that wouldn't change anything are skipped.
+//
+// Only sees calls made through it. Code binding things directly (asset loading, ImGui) leaves it
+// stale, so the renderer invalidates it at the start of every submission.
+struct VELOX_API GLStateCache {
+    struct BufferRange {
+        u32        buffer = GL_STATE_UNKNOWN;
+        GLintptr   offset = 0;
+        GLsizeiptr size   = 0;
+    };
+
+    u32 program       = GL_STATE_UNKNOWN;
+    u32 vertexArray   = GL_STATE_UNKNOWN;
+    u32 arrayBuffer   = GL_STATE_UNKNOWN;
+    u32 elementBuffer = GL_STATE_UNKNOWN; // Part of the vertex array's state.
+    u32 textures[GL_STATE_TEXTURE_UNITS];
+
+    BufferRange uniformBuffers[GL_STATE_BUFFER_BINDINGS];
+    BufferRange storageBuffers[GL_STATE_BUFFER_BINDINGS];
+
+    u32    blendEnabled = GL_STATE_UNKNOWN;
+    GLenum blendSource  = GL_NONE;
+    GLenum blendDestination = GL_NONE;
+
+    i32 viewport[4] = { -1, -1, -1, -1 };
+
+    // Since the last resetStats().
+    u32 issued  = 0;
+    u32 skipped = 0;
+
+    GLStateCache() { invalidate(); }
+
+    void invalidate()
+    {
+        program       = GL_STATE_UNKNOWN;
+        vertexArray   = GL_STATE_UNKNOWN;
+        arrayBuffer   = GL_STATE_UNKNOWN;
+        elementBuffer = GL_STATE_UNKNOWN;
+
+        for (u32& texture : textures)
+            texture = GL_STATE_UNKNOWN;
+
+        for (u32 i = 0; i < GL_STATE_BUFFER_BINDINGS; i++)
+        {
+            uniformBuffers[i] = {};
+            storageBuffers[i] = {};
+        }
+
+        blendEnabled     = GL_STATE_UNKNOWN;
+        blendSource      = GL_NONE;
+        blendDestination = GL_NONE;
+
+        for (i32& value : viewport)
+            value = -1;
+    }
+
+    void resetStats()
+    {
+        issued  = 0;
+        skipped = 0;
+    }
+
+    // Returns true when the call has to be made.
+    bool changed(bool isChanged)
+    {
+        if (isChanged) issued  += 1;
+        else           skipped += 1;
+
+        return isChanged;
+    }
+
+    void useProgram(u32 id)
+    {
+        if (!changed(program != id))
+            return;
+
+        program = id;
+        glUseProgram(id);
+    }
+
+    void bindVertexArray(u32 id)
+    {
+        if (!changed(vertexArray != id))
+            return;
+
+        vertexArray = id;
+        glBindVertexArray(id);
+
+        // Comes with the vertex array.
+        elementBuffer = GL_STATE_UNKNOWN;
+    }
+
+    void bindBuffer(GLenum target, u32 id)
+    {
+        u32* bound = nullptr;
+        if      (target == GL_ARRAY_BUFFER)         bound = &arrayBuffer;
+        else if (target == GL_ELEMENT_ARRAY_BUFFER) bound = &elementBuffer;
+
+        if (bound != nullptr && !changed(*bound != id))
+            return;
+
+        if (bound != nullptr)
+            *bound = id;
+
+        glBindBuffer(target, id);
+    }
+
+    // GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+    void bindBufferRange(GLenum target, u32 index, u32 id, GLintptr offset, GLsizeiptr size)
+    {
+        if (!changedRange(target, index, id, offset, size))
+            return;
+
+        glBindBufferRange(target, index, id, offset, size);
+    }
+
+    // Whole buffer, recorded as a range of size 0.
+    void bindBufferBase(GLenum target, u32 index, u32 id)
+    {
+        if (!changedRange(target, index, id, 0, 0))
+            return;
+
+        glBindBufferBase(target, index, id);
+    }
+
+    bool changedRange(GLenum target, u32 index, u32 id, GLintptr offset, GLsizeiptr size)
+    {
+        if (index >= GL_STATE_BUFFER_BINDINGS)
+            return true;
+
+        BufferRange& bound = (target == GL_UNIFORM_BUFFER ? uniformBuffers : storageBuffers)[index];
+        if (!changed(bound.buffer != id || bound.offset != offset || bound.size != size))
+            return false;
+
+        bound = { id, offset, size };
+        return true;
+    }
+
+    // GL_TEXTURE_2D on the unit, without touching the active texture unit.
+    void bindTexture(u32 unit, u32 id)
+    {
+        if (unit >= GL_STATE_TEXTURE_UNITS)
+        {
+            glBindTextureUnit(unit, id);
+            return;
+        }
+
+        if (!changed(textures[unit] != id))
+            return;
+
+        textures[unit] = id;
+        glBindTextureUnit(unit, id);
+    }
+
+    void setBlend(bool enabled, GLenum source = GL_SRC_ALPHA, GLenum destination = GL_ONE_MINUS_SRC_ALPHA)
+    {
+        if (changed(blendEnabled != static_cast<u32>(enabled)))
+        {
+            blendEnabled = enabled;
+            if (enabled) glEnable(GL_BLEND);
+            else         glDisable(GL_BLEND);
+        }
+
+        if (enabled && changed(blendSource != source || blendDestination != destination))
+        {
+            blendSource      = source;
+            blendDestination = destination;
+            glBlendFunc(source, destination);
+        }
+    }
+
+    void setViewport(i32 x, i32 y, i32 width, i32 height)
+    {
+        if (!changed(viewport[0] != x || viewport[1] != y || viewport[2] != width || viewport[3] != height))
+            return;
+
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+        glViewport(x, y, width, height);
+    }
+};
+
+// Of the calling thread's GL context.
+VELOX_API Velox::GLStateCache* getGLState();
+
+}
@@ -2,51 +2,238 @@
 
 #include <Velox.h>
 
+#include "Rendering/GLState.h"
 #include "Rendering/Renderer.h"
 #include "glad/gl.h"
 
-constexpr u32 MAX_QUADS    = 1024; // Everything we render is a quad.
+// Per buffer segment, a pipeline that runs out of room mid-frame moves on to a new segment.
+constexpr u32 MAX_QUADS    = 8192; // Everything we render is a quad.
 constexpr u32 MAX_VERTICES = MAX_QUADS * 4;
 constexpr u32 MAX_INDICES  = MAX_QUADS * 6;
+constexpr u32 MAX_FONT_STYLES = 4096;
 
 namespace Velox {
 
+// How many frames the CPU can write ahead of the GPU before it has to wait.
+constexpr u32 STREAM_BUFFER_SEGMENTS = 3;
+
+// Persistently mapped, coherent buffer split into segments that are used round robin. Draw calls
+// write straight into the current segment, a fence per segment makes sure the GPU is done reading
+// one before it's written again. Nothing gets copied and only the bytes written are ever touched.
+struct StreamBuffer {
+    u32    id = 0;
+    u8*    mapped = nullptr;
+    u32    segmentSize = 0;
+    u32    segment = 0;
+    u32    unfenced = 1; // Segments written since the last fence, the current one included.
+    GLsync fences[STREAM_BUFFER_SEGMENTS] = {};
+
+    // Binds the buffer to target, so for vertex/index buffers the VAO should be bound already.
+    void init(GLenum target, u32 segmentSize, const char* label)
+    {
+        this->segmentSize = segmentSize;
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &id);
+        glBindBuffer(target, id);
+        glBufferStorage(target, static_cast<GLsizeiptr>(segmentSize) * STREAM_BUFFER_SEGMENTS, nullptr, flags);
+        glObjectLabel(GL_BUFFER, id, -1, label);
+
+        mapped = static_cast<u8*>(glMapBufferRange(target, 0, static_cast<GLsizeiptr>(segmentSize) * STREAM_BUFFER_SEGMENTS, flags));
+        if (mapped == nullptr)
+            LOG_ERROR("Failed to map stream buffer '{}'", label);
+    }
+
+    u8* segmentData() { return mapped + segmentOffset(segment); }
+    u32 segmentOffset(u32 index) const { return index * segmentSize; }
+
+    // Whether the next segment is free of draws that haven't been submitted yet.
+    bool canSkipFence() const { return unfenced < STREAM_BUFFER_SEGMENTS; }
+
+    // Fences the unfenced segments once the GPU commands using them so far are done, then moves on
+    // to the next one, waiting if the GPU is still reading it.
+    void nextSegment()
+    {
+        for (u32 i = 0; i < unfenced; i++)
+        {
+            const u32 index = (segment + STREAM_BUFFER_SEGMENTS - i) % STREAM_BUFFER_SEGMENTS;
+            if (fences[index] != nullptr)
+                glDeleteSync(fences[index]);
+            fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        unfenced = 0;
+        nextSegmentUnfenced();
+    }
+
+    // Moves on without a fence, for when what's in the current segment hasn't been submitted yet.
+    // nextSegment() fences it later. Only while canSkipFence().
+    void nextSegmentUnfenced()
+    {
+        segment = (segment + 1) % STREAM_BUFFER_SEGMENTS;
+        unfenced += 1;
+
+        GLsync fence = fences[segment];
+        if (fence == nullptr)
+            return;
+
+        GLbitfield waitFlags = 0;
+        GLuint64   timeout   = 0;
+        while (true)
+        {
+            GLenum result = glClientWaitSync(fence, waitFlags, timeout);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+                break;
+
+            if (result == GL_WAIT_FAILED)
+            {
+                LOG_ERROR("Waiting on stream buffer fence failed");
+                break;
+            }
+
+            // Make sure the fence actually gets submitted, then block for real.
+            waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            timeout   = 1'000'000; // 1ms
+        }
+
+        glDeleteSync(fence);
+        fences[segment] = nullptr;
+    }
+
+    void deInit()
+    {
+        for (GLsync& fence : fences)
+        {
+            if (fence != nullptr)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        if (mapped != nullptr)
+            glUnmapNamedBuffer(id);
+        mapped = nullptr;
+
+        glDeleteBuffers(1, &id);
+    }
+};
+
 struct Pipeline {
     u32 id;
     i32 GLDrawType = GL_TRIANGLES;
+    // Vertex buffer holds one record per draw, indices are record indices. See SpritePipeline.
+    bool instanced = false;
+    // Shared, never changing quad indices (see MAX_QUADS). 0 for pipelines writing their own into indexBuffer.
+    u32 quadIndexBuffer = 0;
 
+    // Of the current segment.
     u32 vertexCount = 0;
-    u32 indexCount = 0;
-    u32 indices[MAX_INDICES];
+    u32 indexCount = 0; // Reserved by draws so far.
+    // Actually written per segment, see submitDrawCommands().
+    u32 submittedIndexCounts[STREAM_BUFFER_SEGMENTS] = {};
 
     u32 vao;
-    u32 vbo;
-    u32 ibo;
+    Velox::StreamBuffer vertexBuffer;
+    Velox::StreamBuffer indexBuffer;
+    // Optional records shared by a whole draw, read by the shaders as storage buffer 3. See FontPipeline.
+    Velox::StreamBuffer drawDataBuffer;
+    u32 drawDataCount = 0;
+
+    // Segment the last use() bound, what draw() reads from.
+    u32 boundSegment = 0;
+
+    // Indices are relative to their vertex segment, see draw().
+    u32* indices(u32 segment) { return reinterpret_cast<u32*>(indexBuffer.mapped + indexBuffer.segmentOffset(segment)); }
 
-    void use(u32 ubo)
+    // The uniform buffer is bound per camera by the renderer.
+    void use(u32 segment)
     {
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
+        Velox::GLStateCache* state = Velox::getGLState();
+
+        boundSegment = segment;
+
+        state->bindVertexArray(vao);
+        state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer.id);
+        state->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer != 0 ? quadIndexBuffer : indexBuffer.id);
+
+        if (instanced)
+        {
+            state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, vertexBuffer.id, vertexBuffer.segmentOffset(segment), vertexBuffer.segmentSize);
+            state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, indexBuffer.id,  indexBuffer.segmentOffset(segment),  indexBuffer.segmentSize);
+        }
+
+        if (drawDataBuffer.id != 0)
+            state->bindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, drawDataBuffer.id, drawDataBuffer.segmentOffset(segment), drawDataBuffer.segmentSize);
+    }
+
+    // indexOffset in bytes from the start of the bound segment's indices.
+    void draw(u32 indexOffset, u32 count)
+    {
+        if (instanced)
+        {
+            // Shader reads its record index at gl_BaseInstance + gl_InstanceID.
+            glDrawArraysInstancedBaseInstance(GLDrawType, 0, 4, count, indexOffset / sizeof(u32));
+            return;
+        }
+
+        glDrawElementsBaseVertex(GLDrawType, count, GL_UNSIGNED_INT,
+                (void*)(uintptr_t)(indexBuffer.segmentOffset(boundSegment) + indexOffset), segmentBaseVertex(boundSegment));
     }
 
+    // For pipelines on the shared quad indices. Run i is counts[i] indices from the start of the
+    // quad indices, starting at vertex baseVertices[i] (see segmentBaseVertex()). One call for all of them.
+    void drawQuadRuns(const GLsizei* counts, const void* const* offsets, const GLint* baseVertices, u32 runCount)
+    {
+        glMultiDrawElementsBaseVertex(GLDrawType, counts, GL_UNSIGNED_INT, offsets, runCount, baseVertices);
+    }
+
+    GLint segmentBaseVertex(u32 segment) const { return segment * MAX_VERTICES; }
+
+    // All of the pipeline's buffers move through their segments together.
+    u32  segment() const { return vertexBuffer.segment; }
+    bool canSkipFence() const { return vertexBuffer.canSkipFence(); }
+
     void clearFrameData()
     {
         vertexCount = 0;
         indexCount = 0;
+        submittedIndexCounts[segment()] = 0;
+        drawDataCount = 0;
+    }
+
+    // Call once the draws using the current segments have been submitted.
+    void nextSegment()
+    {
+        vertexBuffer.nextSegment();
+        if (quadIndexBuffer == 0)
+            indexBuffer.nextSegment();
+        if (drawDataBuffer.id != 0)
+            drawDataBuffer.nextSegment();
+        clearFrameData();
+    }
+
+    // Out of room with draws still unsubmitted, they're drawn from the segment they were written to.
+    void nextSegmentUnfenced()
+    {
+        vertexBuffer.nextSegmentUnfenced();
+        if (quadIndexBuffer == 0)
+            indexBuffer.nextSegmentUnfenced();
+        if (drawDataBuffer.id != 0)
+            drawDataBuffer.nextSegmentUnfenced();
+        clearFrameData();
     }
 
     void deInit()
     {
-        glDeleteBuffers(1, &vbo);
-        glDeleteBuffers(1, &vao);
-        glDeleteBuffers(1, &ibo);
+        vertexBuffer.deInit();
+        indexBuffer.deInit();
+        drawDataBuffer.deInit();
+        glDeleteVertexArrays(1, &vao);
     }
 };
 
 struct LinePipeline : Pipeline {
-    Velox::LineVertex vertices[MAX_VERTICES];
+    Velox::LineVertex* vertices() { return reinterpret_cast<Velox::LineVertex*>(vertexBuffer.segmentData()); }
 
     void init(u32 id)
     {
@@ -57,158 +244,130 @@ struct LinePipeline : Pipeline {
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
-        glGenBuffers(1, &vbo);
-
         glObjectLabel(GL_VERTEX_ARRAY, vao, -1, "Line Attributes");
 
         // Vertex buffer
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, vbo, -1, "Line Vertex Buffer");
+        vertexBuffer.init(GL_ARRAY_BUFFER, sizeof(Velox::LineVertex) * MAX_VERTICES, "Line Vertex Buffer");
 
         // Vertex attributes
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Velox::LineVertex), (void*)offsetof(Velox::LineVertex, position));
         glEnableVertexAttribArray(0);
 
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Velox::LineVertex), (void*)offsetof(Velox::LineVertex, color));
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Velox::LineVertex), (void*)offsetof(Velox::LineVertex, color));
         glEnableVertexAttribArray(1);
 
-        glGenBuffers(1, &ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, ibo, -1, "Line Index Buffer");
+        indexBuffer.init(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * MAX_INDICES, "Line Index Buffer");
 
         glBindVertexArray(0);
     }
-
-    void copyData()
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), &vertices);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), &indices);
-    }
 };
 
 struct TexturedQuadPipeline : Pipeline {
-    Velox::TextureVertex vertices[MAX_VERTICES];
+    Velox::TextureVertex* vertices() { return reinterpret_cast<Velox::TextureVertex*>(vertexBuffer.segmentData()); }
 
-    void init(u32 id)
+    void init(u32 id, u32 quadIndexBuffer)
     {
         this->id = id;
+        this->quadIndexBuffer = quadIndexBuffer;
 
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
-        glGenBuffers(1, &vbo);
-
         glObjectLabel(GL_VERTEX_ARRAY, vao, -1, "Textured Quad Attributes");
 
         // Vertex buffer
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, vbo, -1, "Textured Quad Vertex Buffer");
-
-        // Vertex attributes
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, position));
-        glEnableVertexAttribArray(0);
-
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, color));
-        glEnableVertexAttribArray(1);
+        vertexBuffer.init(GL_ARRAY_BUFFER, sizeof(Velox::TextureVertex) * MAX_VERTICES, "Textured Quad Vertex Buffer");
 
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, uv));
-        glEnableVertexAttribArray(2);
+        setupAttributes();
 
-        glGenBuffers(1, &ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, ibo, -1, "Textured Quad Index Buffer");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
 
         glBindVertexArray(0);
     }
 
-    void copyData()
+    // For the bound VAO and GL_ARRAY_BUFFER, also used by static batches.
+    static void setupAttributes()
     {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), &vertices);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, position));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, color));
+        glEnableVertexAttribArray(1);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), &indices);
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, uv));
+        glEnableVertexAttribArray(2);
+
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(Velox::TextureVertex), (void*)offsetof(Velox::TextureVertex, textureSlot));
+        glEnableVertexAttribArray(3);
     }
 };
 
-struct FontPipeline : Pipeline {
-    Velox::FontVertex vertices[MAX_VERTICES];
+// Sprites without any vertices: the shader fetches SpriteInstance records from the vertex buffer
+// (as storage buffer 1), going through the indices (storage buffer 2) so they can be drawn in
+// sorted order, and builds the quad from gl_VertexID.
+struct SpritePipeline : Pipeline {
+    Velox::SpriteInstance* instances() { return reinterpret_cast<Velox::SpriteInstance*>(vertexBuffer.segmentData()); }
 
     void init(u32 id)
     {
         this->id = id;
 
+        GLDrawType = GL_TRIANGLE_STRIP;
+        instanced  = true;
+
+        // Core profile still wants a VAO bound to draw, it just stays empty.
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
-        glGenBuffers(1, &vbo);
+        glObjectLabel(GL_VERTEX_ARRAY, vao, -1, "Sprite Attributes");
 
-        glObjectLabel(GL_VERTEX_ARRAY, vao, -1, "Font Attributes");
-
-        // Vertex buffer
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, vbo, -1, "Font Vertex Buffer");
-
-        // Vertex attributes
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, position));
-        glEnableVertexAttribArray(0);
+        vertexBuffer.init(GL_SHADER_STORAGE_BUFFER, sizeof(Velox::SpriteInstance) * MAX_VERTICES, "Sprite Instance Buffer");
+        indexBuffer.init(GL_SHADER_STORAGE_BUFFER, sizeof(u32) * MAX_INDICES, "Sprite Order Buffer");
 
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex), 
-                (void*)offsetof(Velox::FontVertex, innerColor));
-        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+};
 
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, uv));
-        glEnableVertexAttribArray(2);
+struct FontPipeline : Pipeline {
+    Velox::FontVertex* vertices() { return reinterpret_cast<Velox::FontVertex*>(vertexBuffer.segmentData()); }
+    Velox::FontStyle*  styles()   { return reinterpret_cast<Velox::FontStyle*>(drawDataBuffer.segmentData()); }
 
-        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, threshold));
-        glEnableVertexAttribArray(3);
+    void init(u32 id, u32 quadIndexBuffer)
+    {
+        this->id = id;
+        this->quadIndexBuffer = quadIndexBuffer;
 
-        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, outBias));
-        glEnableVertexAttribArray(4);
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
 
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, outerColor));
-        glEnableVertexAttribArray(5);
+        glObjectLabel(GL_VERTEX_ARRAY, vao, -1, "Font Attributes");
 
-        glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, outlineWidthAbsolute));
-        glEnableVertexAttribArray(6);
+        // Vertex buffer
+        vertexBuffer.init(GL_ARRAY_BUFFER, sizeof(Velox::FontVertex) * MAX_VERTICES, "Font Vertex Buffer");
 
-        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, outlineWidthRelative));
-        glEnableVertexAttribArray(7);
+        setupAttributes();
 
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
-                (void*)offsetof(Velox::FontVertex, outlineBlur));
-        glEnableVertexAttribArray(8);
+        drawDataBuffer.init(GL_SHADER_STORAGE_BUFFER, sizeof(Velox::FontStyle) * MAX_FONT_STYLES, "Font Style Buffer");
 
-        glGenBuffers(1, &ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_DYNAMIC_DRAW);
-        glObjectLabel(GL_BUFFER, ibo, -1, "Font Index Buffer");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
 
         glBindVertexArray(0);
     }
 
-    void copyData()
+    // For the bound VAO and GL_ARRAY_BUFFER, also used by static batches.
+    static void setupAttributes()
     {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), &vertices);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Velox::FontVertex),
+                (void*)offsetof(Velox::FontVertex, position));
+        glEnableVertexAttribArray(0);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), &indices);
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Velox::FontVertex),
+                (void*)offsetof(Velox::FontVertex, uv));
+        glEnableVertexAttribArray(1);
+
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(Velox::FontVertex),
+                (void*)offsetof(Velox::FontVertex, style));
+        glEnableVertexAttribArray(2);
     }
 };
 
@@ -17,27 +17,49 @@ struct UniformBufferObject {
     i32   padding[2]; // padding to match GLSL std140 layout
 };
 
-struct alignas(16) TextureVertex {
+// Colours are RGBA8 (glm::packUnorm4x8), uvs two 16-bit unorms (glm::packUnorm2x16).
+
+struct TextureVertex {
+    vec3 position;
+    u32  color;
+    u32  uv;
+    u32  textureSlot; // Texture unit of the draw's texture group, see DrawCommand.
+};
+
+struct LineVertex {
     vec3 position;
-    vec4 color;
-    vec2 uv;
+    u32  color;
 };
 
-struct alignas(16) LineVertex {
+struct FontVertex {
     vec3 position;
-    vec4 color;
+    u32  uv;
+    u32  style; // Index into the font pipeline's FontStyles.
+};
+
+// Same for every glyph of a drawText() call, so it's stored once and looked up by the vertices.
+// Matches the std430 layout in sdf_quad.vert.glsl.
+struct FontStyle {
+    vec4 innerColor;
+    vec4 outerColor;
+    f32  threshold;
+    f32  outBias;
+    f32  outlineWidthAbsolute;
+    f32  outlineWidthRelative;
+    f32  outlineBlur;
+    f32  padding[3];
 };
 
-struct alignas(16) FontVertex {
-    vec3  position;
-    vec4  innerColor;
-    vec2  uv;
-    float threshold;
-    float outBias;
-    vec4  outerColor;
-    float outlineWidthAbsolute;
-    float outlineWidthRelative;
-    float outlineBlur;
+// One per sprite, the vertex shader (sprite.vert.glsl) expands it into a quad. Matches the std430
+// layout of the shader's struct.
+struct SpriteInstance {
+    vec2 position;     // Top left before rotation.
+    vec2 size;
+    vec4 uvRect;       // x, y, w, h.
+    f32  rotation;     // Degrees, around the centre.
+    u32  color;        // RGBA8.
+    u32  textureSlot;
+    f32  depth;
 };
 
 struct TextDrawStyle {
@@ -68,6 +90,9 @@ struct TextContinueInfo {
 
 struct Texture {
     u32  id;
+    // Part of id this texture covers in uv space, less than all of it for textures in an atlas.
+    // Applied by the drawQuad functions on top of their own uvs.
+    Velox::Rectangle uvRect { 0.0f, 0.0f, 1.0f, 1.0f };
     void use();
 };
 
@@ -79,14 +104,75 @@ struct ShaderProgram {
 };
 
 struct Pipeline;
+struct StaticBatch;
+struct DrawList;
 struct DrawCommand {
+    u64 sortKey = 0; // See setDrawLayer().
     Velox::Pipeline* pipeline;
     ShaderProgram*   shader;
     Texture*         texture;
-    u32 indexOffset = 0;
-    u32 numIndices  = 0;
+    // Default shader and sprite draws share texture groups: up to a texture unit's worth of textures bound
+    // at once, each vertex says which one to sample. UINT32_MAX for draws that bind just texture.
+    u32 textureGroup = UINT32_MAX;
+    u32 vertexOffset = 0; // Into the pipeline's segment.
+    u32 segment      = 0; // Of the pipeline's buffers, a frame's draws can span several.
+    u32 indexOffset  = 0; // Indices are only written on submission, once the order is known.
+    u32 numIndices   = 0;
+    // Set for draws of a recorded static batch, everything else is looked up in the batch.
+    Velox::StaticBatch* staticBatch = nullptr;
+    u32 staticDraw      = 0;
+    u32 staticTransform = 0;
+};
+
+// Timed sections of a frame, each is also a GL debug group.
+enum RenderPass {
+    RenderPass_Copy,
+    RenderPass_Draw,
+    RenderPass_ImGui,
+    RenderPass_COUNT,
+};
+
+struct RenderStats {
+    u32 quads     = 0;
+    u32 flushes   = 0; // Mid-frame, from a pipeline running out of all its segments.
+    u32 drawCalls = 0;
+
+    // Binds done while submitting, not counting the first of each.
+    u32 pipelineChanges = 0;
+    u32 shaderChanges   = 0;
+    u32 textureChanges  = 0;
+
+    // State setting GL calls that went through the state cache, and those it found redundant.
+    u32 glCallsIssued  = 0;
+    u32 glCallsSkipped = 0;
+
+    // Milliseconds per pass. CPU is the submitting thread's time in the pass, GPU comes from timer
+    // queries read back a few frames late (0 until the first ones come in).
+    f32 cpuPassMs[RenderPass_COUNT] = {};
+    f32 gpuPassMs[RenderPass_COUNT] = {};
+    f32 gpuFrameMs = 0.0f; // Start of the first pass to the end of the last.
+
+    u32 stateChanges() const { return pipelineChanges + shaderChanges + textureChanges; }
 };
 
+constexpr u8 DRAW_LAYER_DEFAULT = 0;
+constexpr u8 DRAW_LAYER_UI      = 200;
+
+// 2D camera, layers are drawn through one (world space) or none (screen space).
+struct Camera {
+    // World position at the top left of the viewport. Zoom and rotation pivot around its center.
+    vec2 position = vec2(0.0f);
+    f32  zoom     = 1.0f;
+    f32  rotation = 0.0f; // Degrees, like drawRotatedQuad().
+    // Part of the window drawn into, 0..1 from the top left.
+    Velox::Rectangle viewport { 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+constexpr u32 MAX_CAMERAS = 8;
+
+// Upper limit of Config::framesInFlight.
+constexpr u32 MAX_FRAMES_IN_FLIGHT = 3;
+
 VELOX_API SDL_Window* GetWindow();
 VELOX_API void* GetGLContext();
 
@@ -95,6 +181,43 @@ VELOX_API i32 getVsyncMode();
 
 VELOX_API f32 getDisplayScale();
 
+// Of the last completed frame.
+VELOX_API const Velox::RenderStats& getRenderStats();
+VELOX_API const char* getRenderPassName(Velox::RenderPass pass);
+
+// Draws are sorted before they're submitted so draws sharing state end up in one draw call.
+// Order is layer, then depth (z of the draw's position, higher on top), then pipeline, shader and
+// texture. Draws with equal keys keep their submission order. That holds for the whole frame unless a
+// pipeline runs out of all of its buffer segments (see RenderStats::flushes), everything before
+// that is drawn first then.
+//
+// Applies to draws made after the call, goes back to DRAW_LAYER_DEFAULT every frame.
+VELOX_API void setDrawLayer(u8 layer);
+VELOX_API u8 getDrawLayer();
+// Draws in an ordered layer are only sorted by layer, so they're drawn in submission order.
+// For overlapping draws where neither depth nor state should decide what ends up on top.
+VELOX_API void setDrawLayerOrdered(u8 layer, bool ordered);
+
+// Cameras are read when draws are submitted, so moving one scrolls everything drawn through it.
+// The main camera always exists.
+VELOX_API Velox::Camera* getMainCamera();
+// nullptr once there are MAX_CAMERAS.
+VELOX_API Velox::Camera* createCamera();
+// Layers drawn through it go back to the main camera. nullptr is ignored.
+VELOX_API void destroyCamera(Velox::Camera* camera);
+// nullptr draws the layer in screen space: window coordinates over the whole window. Layers below
+// DRAW_LAYER_UI use the main camera by default, the rest are screen space.
+VELOX_API void setDrawLayerCamera(u8 layer, Velox::Camera* camera);
+VELOX_API Velox::Camera* getDrawLayerCamera(u8 layer);
+
+// camera == nullptr is screen space for all of these.
+VELOX_API mat4 getCameraView(const Velox::Camera* camera);
+// screenPosition in window coordinates, like mouse positions.
+VELOX_API vec2 screenToWorld(const vec2& screenPosition, const Velox::Camera* camera);
+VELOX_API vec2 worldToScreen(const vec2& worldPosition, const Velox::Camera* camera);
+// World space rectangle the camera currently shows.
+VELOX_API Velox::Rectangle getViewBounds(const Velox::Camera* camera);
+
 VELOX_API void setResolution(ivec2 newResolution);
 VELOX_API void setVsyncMode(int newMode);
 VELOX_API bool isAdaptiveVsyncSupported();
@@ -105,8 +228,17 @@ bool rendererEventCallback(SDL_Event& event);
 
 void drawFrame();
 
+// With Config::renderThread this only hands the frame to the render thread, which owns the GL
+// context and submits and swaps it while the next frame is being built. Render stats lag behind
+// by the frames in flight then.
 VELOX_API void submitFrameData();
 
+// Blocks until every frame handed to the render thread has been drawn. Call before freeing
+// anything those frames might still draw with.
+VELOX_API void waitForRenderThread();
+// 0 without a render thread.
+VELOX_API u32 getFramesInFlight();
+
 void doCopyPass();
 
 void doRenderPass();
@@ -126,6 +258,10 @@ VELOX_API void drawRotatedQuad(const vec3& position, const vec2& size, const vec
 VELOX_API void drawQuadUV(const Velox::Rectangle& outRect, const Velox::Rectangle& inRect, 
         const vec4& color, Velox::Texture* texture = nullptr, Velox::ShaderProgram* shader = nullptr);
 
+// Instanced version of drawRotatedQuad(), one small record per sprite instead of four vertices.
+VELOX_API void drawSprite(const vec3& position, const vec2& size, const vec4& color,
+        f32 rotation = 0.0f, Velox::Texture* texture = nullptr);
+
 VELOX_API void drawLine(const vec3& p0, const vec3& p1, const vec4& color);
 
 VELOX_API void drawRect(const Velox::Rectangle& rect, const vec4& color);
@@ -135,5 +271,39 @@ VELOX_API TextContinueInfo drawText(const char* text, const vec3& position,
         const Velox::TextDrawStyle& style = *Velox::GetUsingTextStyle(),
         TextContinueInfo* textContinueInfo = nullptr);
 
+// Static batches: quads and text recorded once into GPU buffers that are kept around, then
+// drawn every frame without touching their vertices again. Draws between begin and end go
+// into the batch instead of the frame, except lines and quads with a custom shader, which
+// are still drawn right away. Sprites are recorded as rotated quads.
+//
+// Draws only reference the batch, so don't invalidate or destroy it between drawing and the end of the frame.
+VELOX_API Velox::StaticBatch* createStaticBatch(const char* name);
+// Clears whatever the batch held and starts recording into it.
+VELOX_API void beginStaticBatch(Velox::StaticBatch* batch);
+VELOX_API void endStaticBatch();
+// transform is applied on top of the recorded positions. Uses the current draw layer.
+VELOX_API void drawStaticBatch(Velox::StaticBatch* batch, const mat4& transform = mat4(1.0f));
+// Frees the GPU buffers, the batch draws nothing until it's recorded again.
+VELOX_API void invalidateStaticBatch(Velox::StaticBatch* batch);
+VELOX_API void destroyStaticBatch(Velox::StaticBatch* batch);
+VELOX_API bool isStaticBatchValid(const Velox::StaticBatch* batch);
+
+// Draw lists: draws recorded on any thread into memory of the list, then replayed into the frame
+// on the main thread. Replaying lists in a fixed order gives exactly the same frame, down to the
+// bytes uploaded, as making the same draws on the main thread in that order. Which thread recorded
+// what doesn't matter. Everything records, drawStaticBatch() included.
+//
+// A thread records into one list at a time, threads that aren't recording must not draw at all.
+// Recording starts at DRAW_LAYER_DEFAULT, setDrawLayer() in between only applies to the list.
+VELOX_API Velox::DrawList* createDrawList(const char* name);
+VELOX_API void destroyDrawList(Velox::DrawList* list);
+// Clears the list, this thread's draws go into it until endDrawList().
+VELOX_API void beginDrawList(Velox::DrawList* list);
+VELOX_API void endDrawList();
+// Draws recorded so far, for splitting a list between submitDrawList() calls.
+VELOX_API u32 getDrawListSize(const Velox::DrawList* list);
+// Main thread only. Replays the recorded draws [begin, end), the list keeps them.
+VELOX_API void submitDrawList(Velox::DrawList* list, u32 begin = 0, u32 end = UINT32_MAX);
+
 
 }
@@ -6,7 +6,10 @@
 
 namespace Velox {
 
+// Fixed update step, in seconds.
 VELOX_API f64 getDeltaTime();
+// Measured time between the last two calculateDeltaTime() calls, in seconds.
+VELOX_API f64 getFrameTime();
 
 VELOX_API void calculateDeltaTime();
 
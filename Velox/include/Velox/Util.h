@@ -18,4 +18,13 @@ bool isOverlapping(const Velox::Rectangle& rectA, const Velox::Rectangle& rectB)
 
 bool isMouseInArea(const Velox::Rectangle& rect);
 
+struct SortItem {
+    u64 key;
+    u32 value;
+};
+
+// Stable LSD radix sort on key, 8 bits per pass. Passes where every key has the same byte are
+// skipped, so unused high bits cost nothing. scratch is resized as needed and can be reused.
+VELOX_API void radixSort(std::vector<Velox::SortItem>* items, std::vector<Velox::SortItem>* scratch);
+
 }
@@ -0,0 +1,13 @@
+#version 460 core
+
+layout(location=0) in vec2 uv;
+
+layout(location=0) out vec4 frag_color;
+
+// Premultiplied alpha.
+layout(binding=0) uniform sampler2D image;
+
+void main()
+{
+    frag_color = texture(image, uv);
+}
@@ -0,0 +1,12 @@
+#version 460 core
+
+layout(location=0) out vec2 out_uv;
+
+// One triangle covering the whole viewport, no vertex data.
+void main()
+{
+    vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    gl_Position = vec4(uv * 2.0f - 1.0f, 0.0f, 1.0f);
+    out_uv = uv;
+}
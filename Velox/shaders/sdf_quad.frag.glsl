@@ -3,14 +3,14 @@
 // Very much inspired/taken from a series of RedBlobGames articles.
 // https://www.redblobgames.com/x/2403-distance-field-fonts/
 
-layout(location=0) in vec4  inner_color;
-layout(location=1) in vec2  uv;
-layout(location=2) in float threshold;
-layout(location=3) in float out_bias;
-layout(location=4) in vec4  outer_color;
-layout(location=5) in float outline_width_absolute;
-layout(location=6) in float outline_width_relative;
-layout(location=7) in float outline_blur;
+layout(location=0) flat in vec4  inner_color;
+layout(location=1)      in vec2  uv;
+layout(location=2) flat in float threshold;
+layout(location=3) flat in float out_bias;
+layout(location=4) flat in vec4  outer_color;
+layout(location=5) flat in float outline_width_absolute;
+layout(location=6) flat in float outline_width_relative;
+layout(location=7) flat in float outline_blur;
 
 layout(location=0) out vec4 frag_color;
 
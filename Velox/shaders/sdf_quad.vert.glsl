@@ -7,35 +7,51 @@ layout(std140, binding=0) uniform ubo
     ivec2 u_resolution;
 };
 
-layout(location=0) in vec3  in_position;
-layout(location=1) in vec4  in_inner_color;
-layout(location=2) in vec2  in_uv;
-layout(location=3) in float in_threshold;
-layout(location=4) in float in_out_bias;
-layout(location=5) in vec4  in_outer_color;
-layout(location=6) in float in_outline_width_absolute;
-layout(location=7) in float in_outline_width_relative;
-layout(location=8) in float in_outline_blur;
-
-layout(location=0) out vec4  inner_color;
-layout(location=1) out vec2  uv;
-layout(location=2) out float threshold;
-layout(location=3) out float out_bias;
-layout(location=4) out vec4  outer_color;
-layout(location=5) out float outline_width_absolute;
-layout(location=6) out float outline_width_relative;
-layout(location=7) out float outline_blur;
+// Static batches only, identity otherwise.
+layout(location=0) uniform mat4 u_model = mat4(1.0f);
+
+// Matches Velox::FontStyle, one per drawText() call.
+struct FontStyle
+{
+    vec4  inner_color;
+    vec4  outer_color;
+    float threshold;
+    float out_bias;
+    float outline_width_absolute;
+    float outline_width_relative;
+    float outline_blur;
+};
+
+layout(std430, binding=3) readonly buffer font_styles
+{
+    FontStyle styles[];
+};
+
+layout(location=0) in vec3 in_position;
+layout(location=1) in vec2 in_uv;
+layout(location=2) in uint in_style;
+
+layout(location=0) flat out vec4  inner_color;
+layout(location=1)      out vec2  uv;
+layout(location=2) flat out float threshold;
+layout(location=3) flat out float out_bias;
+layout(location=4) flat out vec4  outer_color;
+layout(location=5) flat out float outline_width_absolute;
+layout(location=6) flat out float outline_width_relative;
+layout(location=7) flat out float outline_blur;
 
 void main()
 {
-    gl_Position = u_projection * u_view * vec4(in_position, 1.0f);
+    gl_Position = u_projection * u_view * u_model * vec4(in_position, 1.0f);
+
+    FontStyle style = styles[in_style];
 
-    inner_color            = in_inner_color;
+    inner_color            = style.inner_color;
     uv                     = in_uv;
-    threshold              = in_threshold;
-    out_bias               = in_out_bias;
-    outer_color            = in_outer_color;
-    outline_width_absolute = in_outline_width_absolute;
-    outline_width_relative = in_outline_width_relative;
-    outline_blur           = in_outline_blur;
+    threshold              = style.threshold;
+    out_bias               = style.out_bias;
+    outer_color            = style.outer_color;
+    outline_width_absolute = style.outline_width_absolute;
+    outline_width_relative = style.outline_width_relative;
+    outline_blur           = style.outline_blur;
 }
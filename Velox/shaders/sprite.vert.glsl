@@ -0,0 +1,59 @@
+#version 460 core
+
+layout(std140, binding=0) uniform ubo
+{
+    mat4 u_projection;
+    mat4 u_view;
+    ivec2 u_resolution;
+};
+
+// Matches Velox::SpriteInstance.
+struct Sprite
+{
+    vec2  position;
+    vec2  size;
+    vec4  uv_rect;
+    float rotation;
+    uint  color;
+    uint  texture_slot;
+    float depth;
+};
+
+layout(std430, binding=1) readonly buffer sprite_instances
+{
+    Sprite sprites[];
+};
+
+// Sprite indices in draw order.
+layout(std430, binding=2) readonly buffer sprite_order
+{
+    uint order[];
+};
+
+layout(location=0) out vec4 out_color;
+layout(location=1) out vec2 out_uv;
+layout(location=2) flat out uint out_texture_slot;
+
+void main()
+{
+    Sprite sprite = sprites[order[gl_BaseInstance + gl_InstanceID]];
+
+    // Triangle strip: (0, 0), (1, 0), (0, 1), (1, 1).
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    // Same as drawRotatedQuad(), rotated around the centre.
+    vec2 local = (corner - 0.5f) * sprite.size;
+    float s = sin(radians(sprite.rotation));
+    float c = cos(radians(sprite.rotation));
+    vec2 position = sprite.position + 0.5f * sprite.size + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+    // World space.
+    gl_Position = u_projection * u_view * vec4(position, sprite.depth, 1.0f);
+
+    // Textures are flipped on load, so v runs the other way.
+    vec2 uv = vec2(corner.x, 1.0f - corner.y);
+
+    out_color        = unpackUnorm4x8(sprite.color);
+    out_uv           = sprite.uv_rect.xy + uv * sprite.uv_rect.zw;
+    out_texture_slot = sprite.texture_slot;
+}
@@ -1,14 +1,36 @@
 #version 460 core
 
+// Must match MAX_TEXTURE_SLOTS in Renderer.cpp.
+#define MAX_TEXTURE_SLOTS 16
+
 layout(location=0) in vec4 color;
 layout(location=1) in vec2 uv;
+layout(location=2) flat in uint texture_slot;
 
 layout(location=0) out vec4 frag_color;
 
-uniform sampler2D texture_sampler;
+// Slot i is texture unit i.
+layout(binding=0) uniform sampler2D texture_samplers[MAX_TEXTURE_SLOTS];
+
+// Sampler arrays can only be indexed with dynamically uniform values, the slot can differ per
+// quad so every index has to be a constant.
+#define SAMPLE_SLOT(i) case i: return texture(texture_samplers[i], uv);
+
+vec4 sampleSlot(uint slot)
+{
+    switch (int(slot))
+    {
+        SAMPLE_SLOT(0)  SAMPLE_SLOT(1)  SAMPLE_SLOT(2)  SAMPLE_SLOT(3)
+        SAMPLE_SLOT(4)  SAMPLE_SLOT(5)  SAMPLE_SLOT(6)  SAMPLE_SLOT(7)
+        SAMPLE_SLOT(8)  SAMPLE_SLOT(9)  SAMPLE_SLOT(10) SAMPLE_SLOT(11)
+        SAMPLE_SLOT(12) SAMPLE_SLOT(13) SAMPLE_SLOT(14) SAMPLE_SLOT(15)
+    }
+
+    return texture(texture_samplers[0], uv);
+}
 
 void main()
 {
-    vec4 texture_color = texture(texture_sampler, uv) * color;
+    vec4 texture_color = sampleSlot(texture_slot) * color;
     frag_color = texture_color; 
 }
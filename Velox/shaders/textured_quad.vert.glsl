@@ -7,18 +7,24 @@ layout(std140, binding=0) uniform ubo
     ivec2 u_resolution;
 };
 
+// Static batches only, identity otherwise.
+layout(location=0) uniform mat4 u_model = mat4(1.0f);
+
 layout(location=0) in vec3 in_position;
 layout(location=1) in vec4 in_color;
 layout(location=2) in vec2 in_uv;
+layout(location=3) in uint in_texture_slot;
 
 layout(location=0) out vec4 out_color;
 layout(location=1) out vec2 out_uv;
+layout(location=2) flat out uint out_texture_slot;
 
 void main()
 {
     // World space.
-    gl_Position = u_projection * u_view * vec4(in_position, 1.0f);
+    gl_Position = u_projection * u_view * u_model * vec4(in_position, 1.0f);
 
     out_color   = in_color;
     out_uv      = in_uv;
+    out_texture_slot = in_texture_slot;
 }
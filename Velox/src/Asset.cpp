@@ -2,6 +2,7 @@
 #include <PCH.h>
 
 #include "Arena.h"
+#include "Config.h"
 #include "Rendering/Renderer.h"
 
 #include <SDL3_image/SDL_image.h>
@@ -11,12 +12,98 @@
 #include <SDL3/SDL_surface.h>
 #include <glad/gl.h>
 
+#include <algorithm>
 #include <fstream>
 
 static Velox::Arena g_assetStorage(1024);
 static Velox::AssetManager g_assetManager {};
 static msdfgen::FreetypeHandle* g_freetype;
 
+static u32 s_atlasTextureCount = 0;
+
+// Around each texture in an atlas, filled with the texture's edge so filtering doesn't pull in neighbours.
+constexpr i32 ATLAS_PADDING = 1;
+
+static Velox::TextureAtlasPage createAtlasPage(u32 index)
+{
+    Velox::TextureAtlasPage page { 0, msdf_atlas::RectanglePacker(Velox::TEXTURE_ATLAS_PAGE_SIZE, Velox::TEXTURE_ATLAS_PAGE_SIZE) };
+
+    glGenTextures(1, &page.id);
+    glBindTexture(GL_TEXTURE_2D, page.id);
+
+    std::string label = fmt::format("Texture Atlas {}", index);
+    glObjectLabel(GL_TEXTURE, page.id, -1, label.c_str());
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Velox::TEXTURE_ATLAS_PAGE_SIZE, Velox::TEXTURE_ATLAS_PAGE_SIZE, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // No mipmaps, lower levels would blend neighbouring textures together.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return page;
+}
+
+// Packs surface (ABGR8888) into the first atlas page with room, making a new page if none have.
+// Returns false if the texture shouldn't go in an atlas.
+static bool packIntoAtlas(std::vector<Velox::TextureAtlasPage>* pages, SDL_Surface* surface, Velox::Texture* texture)
+{
+    const i32 maxSize = std::min(Velox::getConfig()->atlasMaxTextureSize, Velox::TEXTURE_ATLAS_PAGE_SIZE - ATLAS_PADDING * 2);
+    if (surface->w > maxSize || surface->h > maxSize)
+        return false;
+
+    msdf_atlas::Rectangle rect { 0, 0, surface->w + ATLAS_PADDING * 2, surface->h + ATLAS_PADDING * 2 };
+
+    u32 pageIndex = 0;
+    for (; pageIndex < pages->size(); pageIndex++)
+    {
+        if ((*pages)[pageIndex].packer.pack(&rect, 1) == 0)
+            break;
+    }
+
+    if (pageIndex == pages->size())
+    {
+        pages->push_back(createAtlasPage(pageIndex));
+        if (pages->back().packer.pack(&rect, 1) != 0)
+        {
+            LOG_ERROR("Texture of {}x{} doesn't fit in an empty atlas page", surface->w, surface->h);
+            return false;
+        }
+    }
+
+    Velox::TextureAtlasPage& page = (*pages)[pageIndex];
+
+    // Copy with the edge pixels repeated into the padding.
+    std::vector<u32> pixels(static_cast<size_t>(rect.w) * rect.h);
+    for (i32 y = 0; y < rect.h; y++)
+    {
+        const i32 sourceY = std::clamp(y - ATLAS_PADDING, 0, surface->h - 1);
+        const u32* sourceRow = reinterpret_cast<const u32*>(static_cast<const u8*>(surface->pixels) + sourceY * surface->pitch);
+
+        for (i32 x = 0; x < rect.w; x++)
+            pixels[y * rect.w + x] = sourceRow[std::clamp(x - ATLAS_PADDING, 0, surface->w - 1)];
+    }
+
+    glBindTexture(GL_TEXTURE_2D, page.id);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.w, rect.h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    page.usedPixels += static_cast<u64>(rect.w) * rect.h;
+    s_atlasTextureCount += 1;
+
+    const f32 pageSize = static_cast<f32>(Velox::TEXTURE_ATLAS_PAGE_SIZE);
+    texture->id = page.id;
+    texture->uvRect = {
+        (rect.x + ATLAS_PADDING) / pageSize,
+        (rect.y + ATLAS_PADDING) / pageSize,
+        surface->w / pageSize,
+        surface->h / pageSize,
+    };
+
+    return true;
+}
+
 Velox::Texture* Velox::AssetManager::loadTexture(const char* filepath)
 {
     for (auto& pair : textureMap)
@@ -61,6 +148,18 @@ Velox::Texture* Velox::AssetManager::loadTexture(const char* filepath)
     // SDL loads images upside down (think this is standard for non-opengl rendering APIs).
     SDL_FlipSurface(surface, SDL_FLIP_VERTICAL);
 
+    char* ptr = g_assetStorage.alloc<char>(strlen(filepath) + 1);
+    strcpy_s(ptr, strlen(filepath) + 1, filepath);
+
+    Velox::Texture atlasTexture {};
+    if (packIntoAtlas(&atlasPages, surface, &atlasTexture))
+    {
+        SDL_DestroySurface(surface);
+
+        textureMap[ptr] = atlasTexture;
+        return &textureMap[ptr];
+    }
+
     u32 id;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);  
@@ -76,9 +175,6 @@ Velox::Texture* Velox::AssetManager::loadTexture(const char* filepath)
 
     SDL_DestroySurface(surface);
 
-    char* ptr = g_assetStorage.alloc<char>(strlen(filepath) + 1);
-    strcpy_s(ptr, strlen(filepath) + 1, filepath);
-
     textureMap[ptr] = { id };
 
     return &textureMap[ptr];
@@ -451,6 +547,7 @@ Velox::Font* Velox::AssetManager::getFontRef(const char* filepath)
 
 void Velox::AssetManager::deInit()
 {
+    // Textures in an atlas share the page's id, deleting it again is ignored by GL.
     for (auto pair : textureMap)
         glDeleteTextures(1, &pair.second.id);
 
@@ -485,3 +582,18 @@ void Velox::getAssetMemoryUsage(size_t* used, size_t* capacity)
     if (capacity) *capacity = g_assetStorage.size;
 }
 
+
+void Velox::getTextureAtlasUsage(u32* pageCount, u32* textureCount, f32* fillRatio)
+{
+    const std::vector<Velox::TextureAtlasPage>& pages = g_assetManager.atlasPages;
+
+    u64 usedPixels = 0;
+    for (const Velox::TextureAtlasPage& page : pages)
+        usedPixels += page.usedPixels;
+
+    const u64 totalPixels = static_cast<u64>(pages.size()) * Velox::TEXTURE_ATLAS_PAGE_SIZE * Velox::TEXTURE_ATLAS_PAGE_SIZE;
+
+    if (pageCount)    *pageCount    = static_cast<u32>(pages.size());
+    if (textureCount) *textureCount = s_atlasTextureCount;
+    if (fillRatio)    *fillRatio    = totalPixels > 0 ? static_cast<f32>(usedPixels) / totalPixels : 0.0f;
+}
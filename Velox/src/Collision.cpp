@@ -0,0 +1,620 @@
+#include "Collision.h"
+#include <PCH.h>
+
+#include "Bits.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define VELOX_X86 1
+    #include <immintrin.h>
+
+    // MSVC doesn't need per function targets for intrinsics, GCC and Clang do.
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define VELOX_TARGET_SSE
+        #define VELOX_TARGET_AVX2
+    #else
+        #define VELOX_TARGET_SSE  __attribute__((target("sse2")))
+        #define VELOX_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define VELOX_X86 0
+#endif
+
+//
+// Batch overlap kernels
+//
+
+void Velox::RectangleBounds::assign(const Velox::Rectangle* rects, u32 count)
+{
+    minX.resize(count);
+    minY.resize(count);
+    maxX.resize(count);
+    maxY.resize(count);
+
+    for (u32 i = 0; i < count; i++)
+    {
+        // Same sums as Velox::isOverlapping() so results match exactly.
+        minX[i] = rects[i].x;
+        minY[i] = rects[i].y;
+        maxX[i] = rects[i].x + rects[i].w;
+        maxY[i] = rects[i].y + rects[i].h;
+    }
+}
+
+static void clearMask(u64* mask, u32 count)
+{
+    for (u32 word = 0; word < (count + 63) / 64; word++)
+        mask[word] = 0;
+}
+
+static void overlapMaskScalar(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u64* mask)
+{
+    const float minX = rect.x;
+    const float minY = rect.y;
+    const float maxX = rect.x + rect.w;
+    const float maxY = rect.y + rect.h;
+
+    const u32 count = bounds.size();
+    clearMask(mask, count);
+
+    for (u32 i = 0; i < count; i++)
+    {
+        const bool hit = minX < bounds.maxX[i] && maxX > bounds.minX[i] &&
+                         minY < bounds.maxY[i] && maxY > bounds.minY[i];
+
+        mask[i >> 6] |= static_cast<u64>(hit) << (i & 63);
+    }
+}
+
+// Compacts overlapping pairs from [begin, count) to kept onwards, returns the new kept count.
+static u32 overlapPairsTail(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 begin, u32 count, u32 kept)
+{
+    for (u32 i = begin; i < count; i++)
+    {
+        const u32 a = first[i];
+        const u32 b = second[i];
+
+        if (bounds.minX[a] < bounds.maxX[b] && bounds.maxX[a] > bounds.minX[b] &&
+            bounds.minY[a] < bounds.maxY[b] && bounds.maxY[a] > bounds.minY[b])
+        {
+            first[kept]  = a;
+            second[kept] = b;
+            kept += 1;
+        }
+    }
+
+    return kept;
+}
+
+static u32 overlapPairsScalar(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 count)
+{
+    return overlapPairsTail(bounds, first, second, 0, count, 0);
+}
+
+#if VELOX_X86
+
+VELOX_TARGET_SSE
+static void overlapMaskSSE(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u64* mask)
+{
+    const __m128 minX = _mm_set1_ps(rect.x);
+    const __m128 minY = _mm_set1_ps(rect.y);
+    const __m128 maxX = _mm_set1_ps(rect.x + rect.w);
+    const __m128 maxY = _mm_set1_ps(rect.y + rect.h);
+
+    const u32 count = bounds.size();
+    clearMask(mask, count);
+
+    // Blocks of 4 never straddle a mask word.
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 hitX = _mm_and_ps(_mm_cmplt_ps(minX, _mm_loadu_ps(&bounds.maxX[i])),
+                                 _mm_cmpgt_ps(maxX, _mm_loadu_ps(&bounds.minX[i])));
+        __m128 hitY = _mm_and_ps(_mm_cmplt_ps(minY, _mm_loadu_ps(&bounds.maxY[i])),
+                                 _mm_cmpgt_ps(maxY, _mm_loadu_ps(&bounds.minY[i])));
+
+        mask[i >> 6] |= static_cast<u64>(_mm_movemask_ps(_mm_and_ps(hitX, hitY))) << (i & 63);
+    }
+
+    for (; i < count; i++)
+    {
+        const bool hit = rect.x < bounds.maxX[i] && rect.x + rect.w > bounds.minX[i] &&
+                         rect.y < bounds.maxY[i] && rect.y + rect.h > bounds.minY[i];
+
+        mask[i >> 6] |= static_cast<u64>(hit) << (i & 63);
+    }
+}
+
+VELOX_TARGET_SSE
+static u32 overlapPairsSSE(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 count)
+{
+    const float* minX = bounds.minX.data();
+    const float* minY = bounds.minY.data();
+    const float* maxX = bounds.maxX.data();
+    const float* maxY = bounds.maxY.data();
+
+    u32 kept = 0;
+    u32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const u32* a = &first[i];
+        const u32* b = &second[i];
+
+        // No gather before AVX2.
+        __m128 hitX = _mm_and_ps(
+            _mm_cmplt_ps(_mm_setr_ps(minX[a[0]], minX[a[1]], minX[a[2]], minX[a[3]]),
+                         _mm_setr_ps(maxX[b[0]], maxX[b[1]], maxX[b[2]], maxX[b[3]])),
+            _mm_cmpgt_ps(_mm_setr_ps(maxX[a[0]], maxX[a[1]], maxX[a[2]], maxX[a[3]]),
+                         _mm_setr_ps(minX[b[0]], minX[b[1]], minX[b[2]], minX[b[3]])));
+        __m128 hitY = _mm_and_ps(
+            _mm_cmplt_ps(_mm_setr_ps(minY[a[0]], minY[a[1]], minY[a[2]], minY[a[3]]),
+                         _mm_setr_ps(maxY[b[0]], maxY[b[1]], maxY[b[2]], maxY[b[3]])),
+            _mm_cmpgt_ps(_mm_setr_ps(maxY[a[0]], maxY[a[1]], maxY[a[2]], maxY[a[3]]),
+                         _mm_setr_ps(minY[b[0]], minY[b[1]], minY[b[2]], minY[b[3]])));
+
+        // Writes never pass the lane being read, so compacting in place is fine.
+        u32 bits = static_cast<u32>(_mm_movemask_ps(_mm_and_ps(hitX, hitY)));
+        while (bits != 0)
+        {
+            const u32 lane = Velox::countTrailingZeros(bits);
+            bits &= bits - 1;
+
+            first[kept]  = first[i + lane];
+            second[kept] = second[i + lane];
+            kept += 1;
+        }
+    }
+
+    return overlapPairsTail(bounds, first, second, i, count, kept);
+}
+
+VELOX_TARGET_AVX2
+static void overlapMaskAVX2(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u64* mask)
+{
+    const __m256 minX = _mm256_set1_ps(rect.x);
+    const __m256 minY = _mm256_set1_ps(rect.y);
+    const __m256 maxX = _mm256_set1_ps(rect.x + rect.w);
+    const __m256 maxY = _mm256_set1_ps(rect.y + rect.h);
+
+    const u32 count = bounds.size();
+    clearMask(mask, count);
+
+    // Blocks of 8 never straddle a mask word.
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 hitX = _mm256_and_ps(_mm256_cmp_ps(minX, _mm256_loadu_ps(&bounds.maxX[i]), _CMP_LT_OQ),
+                                    _mm256_cmp_ps(maxX, _mm256_loadu_ps(&bounds.minX[i]), _CMP_GT_OQ));
+        __m256 hitY = _mm256_and_ps(_mm256_cmp_ps(minY, _mm256_loadu_ps(&bounds.maxY[i]), _CMP_LT_OQ),
+                                    _mm256_cmp_ps(maxY, _mm256_loadu_ps(&bounds.minY[i]), _CMP_GT_OQ));
+
+        mask[i >> 6] |= static_cast<u64>(_mm256_movemask_ps(_mm256_and_ps(hitX, hitY))) << (i & 63);
+    }
+
+    for (; i < count; i++)
+    {
+        const bool hit = rect.x < bounds.maxX[i] && rect.x + rect.w > bounds.minX[i] &&
+                         rect.y < bounds.maxY[i] && rect.y + rect.h > bounds.minY[i];
+
+        mask[i >> 6] |= static_cast<u64>(hit) << (i & 63);
+    }
+}
+
+VELOX_TARGET_AVX2
+static u32 overlapPairsAVX2(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 count)
+{
+    const float* minX = bounds.minX.data();
+    const float* minY = bounds.minY.data();
+    const float* maxX = bounds.maxX.data();
+    const float* maxY = bounds.maxY.data();
+
+    u32 kept = 0;
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&first[i]));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&second[i]));
+
+        __m256 hitX = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_i32gather_ps(minX, a, 4), _mm256_i32gather_ps(maxX, b, 4), _CMP_LT_OQ),
+            _mm256_cmp_ps(_mm256_i32gather_ps(maxX, a, 4), _mm256_i32gather_ps(minX, b, 4), _CMP_GT_OQ));
+        __m256 hitY = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_i32gather_ps(minY, a, 4), _mm256_i32gather_ps(maxY, b, 4), _CMP_LT_OQ),
+            _mm256_cmp_ps(_mm256_i32gather_ps(maxY, a, 4), _mm256_i32gather_ps(minY, b, 4), _CMP_GT_OQ));
+
+        u32 bits = static_cast<u32>(_mm256_movemask_ps(_mm256_and_ps(hitX, hitY)));
+        while (bits != 0)
+        {
+            const u32 lane = Velox::countTrailingZeros(bits);
+            bits &= bits - 1;
+
+            first[kept]  = first[i + lane];
+            second[kept] = second[i + lane];
+            kept += 1;
+        }
+    }
+
+    return overlapPairsTail(bounds, first, second, i, count, kept);
+}
+
+static bool cpuSupports(Velox::OverlapKernel kernel)
+{
+    if (kernel == Velox::OverlapKernel_Scalar)
+        return true;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    if (kernel == Velox::OverlapKernel_SSE)
+        return sse2;
+
+    // AVX registers also need OS support (OSXSAVE + XCR0).
+    const bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    return avx && avx2;
+#else
+    if (kernel == Velox::OverlapKernel_SSE)
+        return __builtin_cpu_supports("sse2");
+
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#else
+
+static bool cpuSupports(Velox::OverlapKernel kernel)
+{
+    return kernel == Velox::OverlapKernel_Scalar;
+}
+
+#endif
+
+typedef void (*OverlapMaskFn)(const Velox::Rectangle&, const Velox::RectangleBounds&, u64*);
+typedef u32  (*OverlapPairsFn)(const Velox::RectangleBounds&, u32*, u32*, u32);
+
+static Velox::OverlapKernel s_overlapKernel = Velox::OverlapKernel_Scalar;
+static OverlapMaskFn  s_overlapMask  = overlapMaskScalar;
+static OverlapPairsFn s_overlapPairs = overlapPairsScalar;
+
+// Picks the widest supported kernel before anything can query.
+[[maybe_unused]] static bool s_overlapKernelSelected = []()
+{
+    if (!Velox::setOverlapKernel(Velox::OverlapKernel_AVX2))
+        Velox::setOverlapKernel(Velox::OverlapKernel_SSE);
+
+    return true;
+}();
+
+bool Velox::setOverlapKernel(Velox::OverlapKernel kernel)
+{
+    if (kernel >= Velox::OverlapKernel_COUNT || !cpuSupports(kernel))
+        return false;
+
+    switch (kernel)
+    {
+#if VELOX_X86
+        case Velox::OverlapKernel_AVX2:
+            s_overlapMask  = overlapMaskAVX2;
+            s_overlapPairs = overlapPairsAVX2;
+            break;
+        case Velox::OverlapKernel_SSE:
+            s_overlapMask  = overlapMaskSSE;
+            s_overlapPairs = overlapPairsSSE;
+            break;
+#endif
+        default:
+            s_overlapMask  = overlapMaskScalar;
+            s_overlapPairs = overlapPairsScalar;
+            break;
+    }
+
+    s_overlapKernel = kernel;
+    return true;
+}
+
+Velox::OverlapKernel Velox::getOverlapKernel()
+{
+    return s_overlapKernel;
+}
+
+const char* Velox::getOverlapKernelName(Velox::OverlapKernel kernel)
+{
+    switch (kernel)
+    {
+        case Velox::OverlapKernel_Scalar: return "Scalar";
+        case Velox::OverlapKernel_SSE:    return "SSE";
+        case Velox::OverlapKernel_AVX2:   return "AVX2";
+        default:                          return "Unknown";
+    }
+}
+
+void Velox::overlapMask(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u64* mask)
+{
+    s_overlapMask(rect, bounds, mask);
+}
+
+u32 Velox::overlapIndices(const Velox::Rectangle& rect, const Velox::RectangleBounds& bounds, u32* hits)
+{
+    static thread_local std::vector<u64> s_mask;
+    s_mask.resize((bounds.size() + 63) / 64);
+
+    s_overlapMask(rect, bounds, s_mask.data());
+
+    u32 hitCount = 0;
+    for (u32 word = 0; word < s_mask.size(); word++)
+    {
+        u64 bits = s_mask[word];
+        while (bits != 0)
+        {
+            hits[hitCount] = word * 64 + Velox::countTrailingZeros(bits);
+            hitCount += 1;
+            bits &= bits - 1;
+        }
+    }
+
+    return hitCount;
+}
+
+u32 Velox::overlapPairs(const Velox::RectangleBounds& bounds, u32* first, u32* second, u32 count)
+{
+    return s_overlapPairs(bounds, first, second, count);
+}
+
+//
+// CollisionGrid
+//
+
+u32 Velox::CollisionGrid::bucketOf(i32 cellX, i32 cellY) const
+{
+    // Large primes, from "Optimized Spatial Hashing for Collision Detection of Deformable Objects".
+    return ((static_cast<u32>(cellX) * 73856093u) ^ (static_cast<u32>(cellY) * 19349663u)) & bucketMask;
+}
+
+// Cells past this just share the edge cell. Well inside i32, so the cell loops can't overflow either.
+constexpr float MAX_CELL_COORDINATE = 1073741824.0f; // 2^30
+
+// std::floor is a libm call without SSE4.1, this is hit several times per query.
+static inline i32 floorToInt(float value)
+{
+    // Casting NaN or anything out of i32 range is undefined. NaN fails the first compare and ends up at the max.
+    value = value < MAX_CELL_COORDINATE ? value : MAX_CELL_COORDINATE;
+    value = value > -MAX_CELL_COORDINATE ? value : -MAX_CELL_COORDINATE;
+
+    i32 truncated = static_cast<i32>(value);
+    return truncated - (static_cast<float>(truncated) > value);
+}
+
+void Velox::CollisionGrid::cellOf(float x, float y, i32* cellX, i32* cellY) const
+{
+    *cellX = floorToInt(x * inverseCellSize);
+    *cellY = floorToInt(y * inverseCellSize);
+}
+
+// Same test as Velox::isOverlapping(), but visible to the compiler for inlining in the hot loops.
+static inline bool overlaps(const Velox::Rectangle& a, const Velox::Rectangle& b)
+{
+    return a.x < b.x + b.w && a.x + a.w > b.x &&
+           a.y < b.y + b.h && a.y + a.h > b.y;
+}
+
+// Number of cells the rectangle touches, as float so huge rectangles can't overflow.
+static float cellSpan(const Velox::Rectangle& rect, float inverseSize)
+{
+    float spanX = std::floor((rect.x + rect.w) * inverseSize) - std::floor(rect.x * inverseSize) + 1.0f;
+    float spanY = std::floor((rect.y + rect.h) * inverseSize) - std::floor(rect.y * inverseSize) + 1.0f;
+
+    return spanX * spanY;
+}
+
+void Velox::CollisionGrid::build(const Velox::Rectangle* rectangles, u32 count)
+{
+    rects     = rectangles;
+    rectCount = count;
+    bounds.assign(rectangles, count);
+
+    usedCellSize = cellSize;
+    if (usedCellSize <= 0.0f)
+    {
+        // Average size keeps most rectangles in 1-4 cells, with few neighbours per cell.
+        float total = 0.0f;
+        for (u32 i = 0; i < count; i++)
+            total += glm::max(rects[i].w, rects[i].h);
+
+        usedCellSize = count > 0 ? total / static_cast<float>(count) : 1.0f;
+        usedCellSize = glm::max(usedCellSize, 1.0f);
+    }
+
+    inverseCellSize = 1.0f / usedCellSize;
+
+    u32 bucketCount = 64;
+    while (bucketCount < count * 2)
+        bucketCount *= 2;
+
+    bucketMask = bucketCount - 1;
+
+    bucketStarts.assign(bucketCount + 1, 0);
+    oversized.clear();
+
+    // Count records per bucket.
+    u32 recordCount = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        const Velox::Rectangle& rect = rects[i];
+
+        if (cellSpan(rect, inverseCellSize) > static_cast<float>(maxCellsPerRect))
+        {
+            oversized.push_back(i);
+            continue;
+        }
+
+        i32 minX, minY, maxX, maxY;
+        cellOf(rect.x,          rect.y,          &minX, &minY);
+        cellOf(rect.x + rect.w, rect.y + rect.h, &maxX, &maxY);
+
+        for (i32 y = minY; y <= maxY; y++)
+        {
+            for (i32 x = minX; x <= maxX; x++)
+            {
+                bucketStarts[bucketOf(x, y)] += 1;
+                recordCount += 1;
+            }
+        }
+    }
+
+    // Inclusive prefix sum gives each buckets end, filling backwards leaves it at its start.
+    for (u32 b = 1; b < bucketCount; b++)
+        bucketStarts[b] += bucketStarts[b - 1];
+
+    bucketStarts[bucketCount] = recordCount;
+
+    records.resize(recordCount);
+
+    u32 nextOversized = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (nextOversized < oversized.size() && oversized[nextOversized] == i)
+        {
+            nextOversized += 1;
+            continue;
+        }
+
+        const Velox::Rectangle& rect = rects[i];
+
+        i32 minX, minY, maxX, maxY;
+        cellOf(rect.x,          rect.y,          &minX, &minY);
+        cellOf(rect.x + rect.w, rect.y + rect.h, &maxX, &maxY);
+
+        for (i32 y = minY; y <= maxY; y++)
+        {
+            for (i32 x = minX; x <= maxX; x++)
+            {
+                u32& cursor = bucketStarts[bucketOf(x, y)];
+                cursor -= 1;
+                records[cursor] = { i, x, y };
+            }
+        }
+    }
+}
+
+void Velox::CollisionGrid::query(const Velox::Rectangle& rect, std::vector<u32>* hits, u32 ignore) const
+{
+    // Cheaper to just test everything than to walk that many cells.
+    if (cellSpan(rect, inverseCellSize) > static_cast<float>(glm::max(rectCount, maxCellsPerRect)))
+    {
+        const size_t start = hits->size();
+        hits->resize(start + rectCount);
+
+        u32 hitCount = Velox::overlapIndices(rect, bounds, hits->data() + start);
+        hits->resize(start + hitCount);
+
+        hits->erase(std::remove(hits->begin() + start, hits->end(), ignore), hits->end());
+        return;
+    }
+
+    i32 minX, minY, maxX, maxY;
+    cellOf(rect.x,          rect.y,          &minX, &minY);
+    cellOf(rect.x + rect.w, rect.y + rect.h, &maxX, &maxY);
+
+    for (i32 y = minY; y <= maxY; y++)
+    {
+        for (i32 x = minX; x <= maxX; x++)
+        {
+            const u32 bucket = bucketOf(x, y);
+
+            for (u32 r = bucketStarts[bucket]; r < bucketStarts[bucket + 1]; r++)
+            {
+                const Record& record = records[r];
+                if (record.cellX != x || record.cellY != y || record.rect == ignore)
+                    continue;
+
+                const Velox::Rectangle& other = rects[record.rect];
+                if (!overlaps(rect, other))
+                    continue;
+
+                // Only report from one of the cells both share.
+                i32 cornerX, cornerY;
+                cellOf(glm::max(rect.x, other.x), glm::max(rect.y, other.y), &cornerX, &cornerY);
+                if (cornerX != x || cornerY != y)
+                    continue;
+
+                hits->push_back(record.rect);
+            }
+        }
+    }
+
+    for (u32 o : oversized)
+    {
+        if (o != ignore && overlaps(rect, rects[o]))
+            hits->push_back(o);
+    }
+}
+
+void Velox::CollisionGrid::queryPairs(std::vector<std::pair<u32, u32>>* pairs) const
+{
+    // Candidates are gathered first so the overlap tests run as one batch.
+    static thread_local std::vector<u32> s_first;
+    static thread_local std::vector<u32> s_second;
+    s_first.clear();
+    s_second.clear();
+
+    for (u32 bucket = 0; bucket <= bucketMask; bucket++)
+    {
+        const u32 end = bucketStarts[bucket + 1];
+
+        for (u32 a = bucketStarts[bucket]; a < end; a++)
+        {
+            const Record& recordA = records[a];
+            const Velox::Rectangle& rectA = rects[recordA.rect];
+
+            for (u32 b = a + 1; b < end; b++)
+            {
+                const Record& recordB = records[b];
+                if (recordA.cellX != recordB.cellX || recordA.cellY != recordB.cellY)
+                    continue;
+
+                // Doesn't need the overlap result, if they do overlap this is the one shared cell
+                // that keeps the pair.
+                const Velox::Rectangle& rectB = rects[recordB.rect];
+
+                i32 cornerX, cornerY;
+                cellOf(glm::max(rectA.x, rectB.x), glm::max(rectA.y, rectB.y), &cornerX, &cornerY);
+                if (cornerX != recordA.cellX || cornerY != recordA.cellY)
+                    continue;
+
+                s_first.push_back(recordA.rect);
+                s_second.push_back(recordB.rect);
+            }
+        }
+    }
+
+    const u32 kept = Velox::overlapPairs(bounds, s_first.data(), s_second.data(), static_cast<u32>(s_first.size()));
+
+    for (u32 i = 0; i < kept; i++)
+        pairs->push_back(std::minmax(s_first[i], s_second[i]));
+
+    // Oversized against everything, pairs of two oversized are reported by the lower index.
+    static thread_local std::vector<u32> s_hits;
+    s_hits.resize(rectCount);
+
+    for (u32 o : oversized)
+    {
+        const u32 hitCount = Velox::overlapIndices(rects[o], bounds, s_hits.data());
+
+        for (u32 h = 0; h < hitCount; h++)
+        {
+            const u32 i = s_hits[h];
+            if (i == o || (i < o && std::binary_search(oversized.begin(), oversized.end(), i)))
+                continue;
+
+            pairs->push_back(std::minmax(o, i));
+        }
+    }
+}
@@ -30,6 +30,9 @@ bool tomlToConfig(toml::table* table, Velox::Config* config)
     config->windowWidth  = table->at_path("rendering.window_width" ).value_or(config->windowWidth);
     config->windowHeight = table->at_path("rendering.window_height").value_or(config->windowHeight);
     config->vsyncMode    = table->at_path("rendering.vsync_mode"   ).value_or(config->vsyncMode);
+    config->atlasMaxTextureSize = table->at_path("rendering.atlas_max_texture_size").value_or(config->atlasMaxTextureSize);
+    config->renderThread   = table->at_path("rendering.render_thread"   ).value_or(config->renderThread);
+    config->framesInFlight = table->at_path("rendering.frames_in_flight").value_or(config->framesInFlight);
 
     return true;
 }
@@ -46,6 +49,9 @@ bool configToToml(Velox::Config* config, toml::table* table)
         { "window_width",  config->windowWidth  },
         { "window_height", config->windowHeight },
         { "vsync_mode",    config->vsyncMode    },
+        { "atlas_max_texture_size", config->atlasMaxTextureSize },
+        { "render_thread",    config->renderThread   },
+        { "frames_in_flight", config->framesInFlight },
     };
 
     *table = toml::table {
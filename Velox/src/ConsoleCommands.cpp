@@ -38,6 +38,9 @@ void Velox::registerDefaultCommands()
     // Draw text alignment info.
     console->registerCommand("debugtext", &Velox::debugText);
 
+    // Toggle sprite benchmark, optionally with a sprite count.
+    console->registerCommand("spritebench", &Velox::spriteBenchmarkCommand);
+
     // Request quit.
     console->registerCommand("quit", &Velox::quitCommand);
 }
@@ -126,6 +129,26 @@ void Velox::debugText(std::string& response, const std::vector<std::string> args
     engineState->drawTextLines= !engineState->drawTextLines;
 }
 
+void Velox::spriteBenchmarkCommand(std::string& response, const std::vector<std::string> args)
+{
+    Velox::EngineState* engineState = Velox::getEngineState();
+
+    if (args.empty())
+    {
+        engineState->spriteBenchmarkCount = engineState->spriteBenchmarkCount > 0 ? 0 : 1000000;
+        return;
+    }
+
+    try
+    {
+        engineState->spriteBenchmarkCount = static_cast<u32>(std::stoul(args[0]));
+    }
+    catch (const std::exception&)
+    {
+        response += fmt::format("'{}' is not a sprite count\n", args[0]);
+    }
+}
+
 void Velox::quitCommand(std::string& response, const std::vector<std::string> args)
 {
     response = "Quitting...\n";
@@ -8,6 +8,7 @@
 #include "Entity.h"
 #include "Event.h"
 #include "Input.h"
+#include "Jobs.h"
 #include "Text.h"
 #include "Timing.h"
 #include "UI.h"
@@ -62,6 +63,11 @@ void Velox::init()
     timeStamp("Config", initStartTime);
 #endif
 
+    Velox::initJobSystem();
+#if SPLIT_TIMES
+    timeStamp("Job System", initStartTime);
+#endif
+
     Velox::initAssets();
 #if SPLIT_TIMES
     timeStamp("Assets", initStartTime);
@@ -137,6 +143,9 @@ Velox::EngineState* Velox::getEngineState()
 
 void Velox::doFrameEndUpdates()
 {
+    if (engineState.spriteBenchmarkCount > 0)
+        Velox::drawSpriteBenchmark(engineState.spriteBenchmarkCount);
+
     Velox::drawConsole();
 
     if (engineState.showPerformanceStats)
@@ -171,11 +180,16 @@ bool Velox::quitRequested()
 
 void Velox::deInit()
 {
+    // Queued frames may still draw with assets.
+    Velox::waitForRenderThread();
+
     Velox::deInitAssets(); // Must be cleaned up before GLContext is destroyed (in deInitRenderer()). (I think...)
 
     Velox::deInitRenderer();
     Velox::deInitUI();
 
+    Velox::deInitJobSystem();
+
     SDL_Quit();    
 }
 
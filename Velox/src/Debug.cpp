@@ -1,5 +1,6 @@
 #include "Debug.h"
 #include <PCH.h>
+#include <SDL3/SDL_timer.h>
 #include <SDL3/SDL_video.h>
 
 #include "Arena.h"
@@ -13,6 +14,8 @@
 #include "Core.h"
 #include "imgui.h"
 
+#include <cmath>
+
 constexpr size_t FRAME_HISTORY_COUNT = 1000;
 
 static float s_frameTimeHistory[FRAME_HISTORY_COUNT];
@@ -102,16 +105,48 @@ void Velox::drawPerformanceStats()
     ImGui::Text("FrameTimes (previous %zu frames)", FRAME_HISTORY_COUNT);
     ImGui::Spacing();
 
-    ImGui::Text("This Frame: %.0fms", s_frameTimeHistory[s_currentIndex]);
+    ImGui::Text("This Frame: %.2fms", s_frameTimeHistory[s_currentIndex]);
     ImGui::Spacing();
     
-    ImGui::Text("Average: %.1fms", average);
+    ImGui::Text("Average: %.2fms", average);
+    ImGui::Spacing();
+
+    ImGui::Text("Max: %.2fms", max);
+    ImGui::Spacing();
+
+    ImGui::Text("Min: %.2fms", min);
+    ImGui::Spacing();
+
+    const Velox::RenderStats& renderStats = Velox::getRenderStats();
+
+    // GPU frame time close to the frame time means GPU bound, far below it means CPU bound (or vsync).
+    ImGui::Text("GPU frame: %.2fms", renderStats.gpuFrameMs);
+    for (u32 pass = 0; pass < Velox::RenderPass_COUNT; pass++)
+    {
+        ImGui::Text("  %s: %.2fms CPU, %.2fms GPU", Velox::getRenderPassName(static_cast<Velox::RenderPass>(pass)),
+                renderStats.cpuPassMs[pass], renderStats.gpuPassMs[pass]);
+    }
+    ImGui::Spacing();
+
+    ImGui::Text("Draw calls: %u (%u quads)", renderStats.drawCalls, renderStats.quads);
+    ImGui::Spacing();
+
+    ImGui::Text("State changes: %u (pipeline %u, shader %u, texture %u)", renderStats.stateChanges(),
+            renderStats.pipelineChanges, renderStats.shaderChanges, renderStats.textureChanges);
+    ImGui::Spacing();
+
+    ImGui::Text("GL state calls: %u issued, %u skipped", renderStats.glCallsIssued, renderStats.glCallsSkipped);
     ImGui::Spacing();
 
-    ImGui::Text("Max: %.0fms", max);
+    if (Velox::getFramesInFlight() > 0)
+        ImGui::Text("Render thread: %u frames in flight", Velox::getFramesInFlight());
+    else
+        ImGui::Text("Render thread: off");
     ImGui::Spacing();
 
-    ImGui::Text("Min: %.0fms", min);
+    Velox::EntityManager* entityManager = Velox::getEntityManager();
+    ImGui::Checkbox("Cull sprites", &entityManager->spriteCulling);
+    ImGui::Text("Sprites: %u submitted, %u culled", entityManager->spritesSubmitted, entityManager->spritesCulled);
     ImGui::Spacing();
 
     float chartMax = max > 20 ? max * 1.1 : 20;
@@ -157,6 +192,16 @@ void Velox::drawMemoryUsageStats() {
 
     ImGui::Text("Bytes used / allocated");
     ImGui::Text("Assets: %zu / %zu", used, capacity);
+
+    size_t entitiesUsed, entitiesCapacity;
+    Velox::getEntityManager()->getMemoryUsage(&entitiesUsed, &entitiesCapacity);
+    ImGui::Text("Entities: %zu / %zu", entitiesUsed, entitiesCapacity);
+    ImGui::Spacing();
+
+    u32 atlasPages, atlasTextures;
+    f32 atlasFillRatio;
+    Velox::getTextureAtlasUsage(&atlasPages, &atlasTextures, &atlasFillRatio);
+    ImGui::Text("Texture atlas: %u textures in %u pages, %.1f%% filled", atlasTextures, atlasPages, atlasFillRatio * 100.0f);
     ImGui::Spacing();
 
     ImGui::Text("percentage:");
@@ -359,28 +404,24 @@ void Velox::drawEntityColliders()
 {
     Velox::EntityManager* entityManager = Velox::getEntityManager();
 
-    for (auto pair : entityManager->iter())
+    entityManager->forEachCollider([](Velox::EntityHandle handle, const Velox::Rectangle& collider)
     {
-        Velox::Entity* entity = pair.second;
-
-        if (!entity->hasFlag(Velox::EntityFlags::Collides))
-            continue;
-
-        Velox::drawRect(entity->collider, COLOR_RED);
-    }
+        Velox::drawRect(collider, COLOR_RED);
+    });
 }
 
-void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
+void addEntityInfo(u32 position, bool topLevel = false)
 {
     Velox::EntityManager* entityManager = Velox::getEntityManager();
 
-    bool hasChildren = !node.children.empty();
+    const Velox::EntityHierarchyEntry& entry = entityManager->hierarchy[position];
+    bool hasChildren = entry.subtreeSize > 1;
 
-    Velox::Entity* entity = entityManager->getMut(node.id);
+    Velox::Entity* entity = entityManager->getMut(entry.handle);
     if (entity == nullptr)
         return;
 
-    if (ImGui::TreeNode(fmt::format("Entity - ID: {}, Type: {}", node.id.index, entity->type).c_str()))
+    if (ImGui::TreeNode(fmt::format("Entity - ID: {}, Type: {}", entry.handle.index, entity->type).c_str()))
     {
 
         if (ImGui::TreeNode("Core"))
@@ -394,17 +435,29 @@ void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
 
         if (ImGui::TreeNode(topLevel ? "Relative Transform (effictively absolute)" : "Relative Transform"))
         {
-            ImGui::InputFloat3("Position", (float*)&entity->position);
-            ImGui::InputFloat("Rotation", (float*)&entity->rotation);
-            ImGui::InputFloat2("Scale", (float*)&entity->scale);
+            // Only write back on edit, writing marks the transform dirty.
+            const Velox::Entity* constEntity = entity;
+
+            vec3 position = constEntity->position();
+            if (ImGui::InputFloat3("Position", (float*)&position))
+                entity->positionMut() = position;
+
+            float rotation = constEntity->rotation();
+            if (ImGui::InputFloat("Rotation", &rotation))
+                entity->rotationMut() = rotation;
+
+            vec2 scale = constEntity->scale();
+            if (ImGui::InputFloat2("Scale", (float*)&scale))
+                entity->scaleMut() = scale;
             ImGui::TreePop();
         }
 
         if (ImGui::TreeNode("Absolute Position"))
         {
-            ImGui::InputFloat3("Position", (float*)&entity->position);
-            ImGui::InputFloat("Rotation", (float*)&entity->rotation);
-            ImGui::InputFloat2("Scale", (float*)&entity->scale);
+            const Velox::EntityTransform& absolute = entity->absolute();
+            ImGui::Text("Position: %.2f, %.2f, %.2f", absolute.position.x, absolute.position.y, absolute.position.z);
+            ImGui::Text("Rotation: %.2f", absolute.rotation);
+            ImGui::Text("Scale: %.2f, %.2f", absolute.scale.x, absolute.scale.y);
             ImGui::TreePop();
         }
 
@@ -414,7 +467,9 @@ void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
             if (ImGui::Checkbox("Collides", &collisionState))
                 entity->setFlag(Velox::EntityFlags::Collides, collisionState);
 
-            ImGui::Checkbox("Center Collision", &entity->collideFromCenter);
+            bool centerCollisionState = entity->hasFlag(Velox::EntityFlags::CollideFromCenter);
+            if (ImGui::Checkbox("Center Collision", &centerCollisionState))
+                entity->setFlag(Velox::EntityFlags::CollideFromCenter, centerCollisionState);
 
             ImGui::TreePop();
         }
@@ -425,9 +480,11 @@ void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
             if (ImGui::Checkbox("Visible", &visibleState))
                 entity->setFlag(Velox::EntityFlags::Visible, visibleState);
 
-            ImGui::Checkbox("Center Draw", &entity->drawFromCenter);
+            bool centerDrawState = entity->hasFlag(Velox::EntityFlags::DrawFromCenter);
+            if (ImGui::Checkbox("Center Draw", &centerDrawState))
+                entity->setFlag(Velox::EntityFlags::DrawFromCenter, centerDrawState);
 
-            ImGui::ColorEdit4("Tint", (float*)&entity->colorTint);
+            ImGui::ColorEdit4("Tint", (float*)&entity->render().colorTint);
             ImGui::TreePop();
         }
 
@@ -435,7 +492,8 @@ void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
         if (hasChildren)
         {
             ImGui::Text("Children");
-            for (const Velox::EntityNode& child : node.children)
+            const u32 end = position + entry.subtreeSize;
+            for (u32 child = position + 1; child < end; child += entityManager->hierarchy[child].subtreeSize)
                 addEntityInfo(child);
         }
 
@@ -445,14 +503,16 @@ void addEntityInfo(const Velox::EntityNode& node, bool topLevel = false)
     if (ImGui::IsItemHovered())
     {
         vec2 windowSize = Velox::getWindowSize();
-        Velox::drawRect(entity->collider, COLOR_GREEN);
+        Velox::drawRect(entity->collider(), COLOR_GREEN);
 
-        vec3 xLineMin = vec3(entity->absolutePosition.x, 0.0f,         0.0f);
-        vec3 xLineMax = vec3(entity->absolutePosition.x, windowSize.y, 0.0f);
+        const vec3& absolutePosition = entity->absolute().position;
+
+        vec3 xLineMin = vec3(absolutePosition.x, 0.0f,         0.0f);
+        vec3 xLineMax = vec3(absolutePosition.x, windowSize.y, 0.0f);
         Velox::drawLine(xLineMin, xLineMax, COLOR_GREEN);
 
-        vec3 yLineMin = vec3(0.0f,         entity->absolutePosition.y, 0.0f);
-        vec3 yLineMax = vec3(windowSize.y, entity->absolutePosition.y, 0.0f);
+        vec3 yLineMin = vec3(0.0f,         absolutePosition.y, 0.0f);
+        vec3 yLineMax = vec3(windowSize.y, absolutePosition.y, 0.0f);
         Velox::drawLine(yLineMin, yLineMax, COLOR_GREEN);
     }
 }
@@ -482,10 +542,13 @@ void Velox::drawEntityHierarchyInfo()
         LOG_INFO("I do nothing :)");
     }
 
+    ImGui::Text("Transforms recomputed this frame: %u / %zu",
+            entityManager->transformsRecomputed, entityManager->aliveCount);
+
     ImGui::Separator();
 
-    for (Velox::EntityNode node : entityManager->treeView.root.children)
-        addEntityInfo(node, true);
+    for (u32 position = 0; position < entityManager->hierarchy.size(); position += entityManager->hierarchy[position].subtreeSize)
+        addEntityInfo(position, true);
     
     
     ImGui::End();
@@ -574,5 +637,97 @@ void Velox::updateFrameHistory()
         s_currentIndex = FRAME_HISTORY_COUNT;
     }
 
-    s_frameTimeHistory[s_currentIndex] = Velox::getDeltaTime();
+    // Milliseconds, measured. getDeltaTime() is the fixed update step.
+    s_frameTimeHistory[s_currentIndex] = static_cast<float>(Velox::getFrameTime() * MS_PER_SECOND);
+}
+
+void Velox::drawSpriteBenchmark(u32 spriteCount)
+{
+    static bool s_instanced = true;
+    static bool s_static    = false;
+    static Velox::StaticBatch* s_staticBatch = nullptr;
+    static u32 s_staticSpriteCount = 0;
+    static vec2 s_staticCellSize {};
+
+    const ivec2 windowSize = Velox::getWindowSize();
+    const f32 time = static_cast<f32>(SDL_NS_TO_MS(SDL_GetTicksNS())) / 1000.0f;
+
+    // Square-ish grid over the window, sprites wobble so nothing can be cached between frames.
+    const u32 columns = static_cast<u32>(std::sqrt(static_cast<f32>(spriteCount))) + 1;
+    const vec2 cellSize = vec2(windowSize) / static_cast<f32>(columns);
+
+    // Same texture drawQuad() defaults to, so both paths draw the same thing.
+    Velox::Texture* whiteTexture = Velox::getAssetManager()->getTexture("white.png");
+
+    const u64 start = SDL_GetPerformanceCounter();
+
+    if (s_static)
+    {
+        if (s_staticBatch == nullptr)
+            s_staticBatch = Velox::createStaticBatch("Sprite Benchmark");
+
+        // Recorded once without the wobble, the whole grid wobbles through the transform instead.
+        if (!Velox::isStaticBatchValid(s_staticBatch) || s_staticSpriteCount != spriteCount
+            || s_staticCellSize != cellSize)
+        {
+            Velox::beginStaticBatch(s_staticBatch);
+            for (u32 i = 0; i < spriteCount; i++)
+            {
+                const f32 x = static_cast<f32>(i % columns);
+                const f32 y = static_cast<f32>(i / columns);
+
+                const vec4 color(x / columns, y / columns, 0.5f, 1.0f);
+                Velox::drawQuad(vec3(x * cellSize.x, y * cellSize.y, 0.0f), cellSize, color);
+            }
+            Velox::endStaticBatch();
+
+            s_staticSpriteCount = spriteCount;
+            s_staticCellSize    = cellSize;
+        }
+
+        const mat4 transform = glm::translate(mat4(1.0f), vec3(std::sin(time) * cellSize.x, 0.0f, 0.0f));
+        Velox::drawStaticBatch(s_staticBatch, transform);
+    }
+
+    for (u32 i = 0; i < spriteCount && !s_static; i++)
+    {
+        const f32 x = static_cast<f32>(i % columns);
+        const f32 y = static_cast<f32>(i / columns);
+
+        vec3 position(x * cellSize.x, y * cellSize.y, 0.0f);
+        position.x += std::sin(time + y * 0.1f) * cellSize.x;
+
+        const vec4 color(x / columns, y / columns, 0.5f, 1.0f);
+
+        if (s_instanced)
+            Velox::drawSprite(position, cellSize, color, 0.0f, whiteTexture);
+        else
+            Velox::drawQuad(position, cellSize, color);
+    }
+
+    const f64 submitSeconds = static_cast<f64>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    const Velox::RenderStats& stats = Velox::getRenderStats();
+
+    ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Sprite Benchmark");
+
+    ImGui::Checkbox("Instanced", &s_instanced);
+    ImGui::Checkbox("Static batch", &s_static);
+    ImGui::Text("Sprites: %u", spriteCount);
+    // Record + sort index, or 4 vertices on the shared quad indices. Static batches upload nothing per frame.
+    size_t bytesPerSprite = s_instanced
+        ? sizeof(Velox::SpriteInstance) + sizeof(u32)
+        : sizeof(Velox::TextureVertex) * 4;
+    if (s_static)
+        bytesPerSprite = 0;
+    ImGui::Text("Bytes/sprite: %zu", bytesPerSprite);
+    ImGui::Text("Submit: %.2fms (%.1fM quads/s)", submitSeconds * 1000.0, spriteCount / submitSeconds / 1e6);
+    ImGui::Text("Quads last frame: %u", stats.quads);
+    ImGui::Text("Flushes/frame: %u", stats.flushes);
+    ImGui::Text("Draw calls/frame: %u", stats.drawCalls);
+    ImGui::Text("State changes/frame: %u", stats.stateChanges());
+    ImGui::Text("GL state calls/frame: %u issued, %u skipped", stats.glCallsIssued, stats.glCallsSkipped);
+
+    ImGui::End();
 }
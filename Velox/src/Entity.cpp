@@ -1,15 +1,17 @@
 #include "Entity.h"
+#include "Jobs.h"
 #include "Rendering/Renderer.h"
 #include "Util.h"
 #include <PCH.h>
 
+#include <algorithm>
 #include <utility>
 
 static Velox::EntityManager s_entityManager;
 
 void Velox::initEntitySystem()
 {
-    s_entityManager = Velox::EntityManager();
+    s_entityManager.destroyAllEntities();
 }
 
 Velox::EntityManager* Velox::getEntityManager()
@@ -19,13 +21,7 @@ Velox::EntityManager* Velox::getEntityManager()
 
 void Velox::Entity::setParent(const EntityHandle& handle)
 {
-    if (!handle.isValid())
-        return;
-
-    parent = handle;
-
-    // Only reason this function exists.
-    // s_entityManager.generateTreeView();
+    manager->setParent(id, handle);
 }
 
 void Velox::Entity::update(const double& deltaTime)
@@ -38,55 +34,22 @@ void Velox::Entity::update(const double& deltaTime)
     updateFunction(*this, deltaTime);
 }
 
-void Velox::Entity::update(const double& deltaTime, Velox::Entity* parentRef)
+static void drawEntitySprite(u32 flags, const Velox::EntityTransform& absolute, const Velox::EntityRenderData& render)
 {
-    if (parentRef != nullptr)
-    {
-        // GM: This is kinda jank.
-        absolutePosition = vec3(vec2(parentRef->absolutePosition) +
-            glm::rotate(vec2(position), glm::radians(parentRef->absoluteRotation)), 0.0f);
+    vec3 usePosition = absolute.position;
 
-        absoluteRotation = glm::mod(parentRef->absoluteRotation + rotation, 360.0f);
-        absoluteScale    = parentRef->absoluteScale * scale;
-    }
-    else
-    {
-        absolutePosition = position;
-        absoluteRotation = glm::mod(rotation, 360.0f);
-        absoluteScale    = scale;
-    }
-
-    collider.x = absolutePosition.x;
-    collider.y = absolutePosition.y;
-    collider.w = absoluteScale.x;
-    collider.h = absoluteScale.y;
-
-    if (collideFromCenter)
+    if ((flags & Velox::EntityFlags::DrawFromCenter) != 0)
     {
-        collider.x -= scale.x / 2.0f;
-        collider.y -= scale.y / 2.0f;
+        usePosition.x -= absolute.scale.x * 0.5f;
+        usePosition.y -= absolute.scale.y * 0.5f;
     }
 
-    if (!hasFlag(Velox::EntityFlags::Updates))
-        return;
-
-    if (updateFunction == nullptr)
-        return;
-    
-    updateFunction(*this, deltaTime);
+    Velox::drawSprite(usePosition, absolute.scale, render.colorTint, absolute.rotation, render.texture);
 }
 
 void defaultDrawSprite(Velox::Entity& e)
 {
-    vec3 usePosition = e.absolutePosition;
-
-    if (e.drawFromCenter)
-    {
-        usePosition.x -= e.absoluteScale.x * 0.5f;
-        usePosition.y -= e.absoluteScale.y * 0.5f;
-    }
-
-    Velox::drawRotatedQuad(usePosition, e.absoluteScale, e.colorTint, e.absoluteRotation, e.texture);
+    drawEntitySprite(e.flags(), e.absolute(), e.render());
 }
 
 void Velox::Entity::draw()
@@ -104,160 +67,167 @@ void Velox::Entity::draw()
     drawFunction(*this);    
 }
 
+void Velox::Entity::getOverlappingEntities(std::vector<Velox::EntityHandle>* overlaps)
+{
+    manager->queryOverlaps(collider(), overlaps, id);
+}
+
 std::vector<Velox::EntityHandle> Velox::Entity::getOverlappingEntities()
 {
     std::vector<Velox::EntityHandle> overlaps;
-
-    for (auto entityPair : s_entityManager.iter())
-    {
-        if (id == entityPair.first)
-            continue;
-
-        if (!entityPair.second->hasFlag(Velox::EntityFlags::Collides))
-            continue;
-
-        if (!Velox::isOverlapping(collider, entityPair.second->collider))
-            continue;
-        
-        overlaps.push_back(entityPair.second->id);
-    }
+    getOverlappingEntities(&overlaps);
 
     return overlaps;
 }
 
 //
-// Entity Node
+// EntityCommandBuffer
 //
 
-bool Velox::EntityNode::isLeaf()
+Velox::EntityHandle Velox::EntityCommandBuffer::createEntity(const EntityHandle& parent, std::function<void(Velox::Entity&)> onCreate)
 {
-    return children.empty();
+    const Velox::EntityHandle pending { static_cast<u32>(commands.size()), ENTITY_PENDING_GENERATION };
+    commands.push_back({ Velox::EntityCommandType::Create, pending, parent, 0, 0, std::move(onCreate) });
+
+    return pending;
 }
 
-bool Velox::EntityNode::addNode(const Velox::EntityNode& node, const Velox::EntityNode& desiredParent)
+void Velox::EntityCommandBuffer::destroyEntity(const EntityHandle& handle)
 {
-    if (id == desiredParent.id)
-    {
-        children.push_back(node);
-        return true;
-    }
-
-    for (EntityNode& child : children)
-    {
-        bool result = child.addNode(node, desiredParent);
-
-        if (result)
-            return true;
-    }
-
-    return false;
+    commands.push_back({ Velox::EntityCommandType::Destroy, handle });
 }
 
-void Velox::EntityNode::update(const double& deltaTime, Entity* parent, bool isRoot)
+void Velox::EntityCommandBuffer::setParent(const EntityHandle& handle, const EntityHandle& parent)
 {
-    Velox::Entity* currentEntity = nullptr;
-
-    if (!isRoot)
-    {
-        currentEntity = s_entityManager.getMut(id);
-        if (currentEntity == nullptr)
-            return;
-
-        currentEntity->update(deltaTime, parent);
-    }
-
-    for (Velox::EntityNode& child : children)
-        child.update(deltaTime, currentEntity);
+    commands.push_back({ Velox::EntityCommandType::SetParent, handle, parent });
 }
 
-void Velox::EntityNode::destroyChildren(const Velox::EntityHandle& handle, bool isRoot)
+void Velox::EntityCommandBuffer::setFlag(const EntityHandle& handle, EntityFlags flag, int state)
 {
-    // Not a node that needs touching, just propogate request.
-    if (handle != id)
-    {
-        for (Velox::EntityNode& child : children)
-            child.destroyChildren(handle);
-
-        return;
-    }
-
-    for (Velox::EntityNode& child : children)
-    {
-        // Pass reference to own id to signal it should be removed.
-        child.destroyChildren(child.id);
-    }
-
-    // Mark for death, wait until end of frame to remove.
-    s_entityManager.getMut(id)->setFlag(Velox::EntityFlags::Dead, true);
+    commands.push_back({ Velox::EntityCommandType::SetFlag, handle, {}, flag, state });
 }
 
 //
-// EntityTreeView
+// EntityManager 
 //
 
-bool Velox::EntityTreeView::addNode(const Velox::EntityHandle& handle, const Velox::EntityHandle& desiredParent)
+Velox::EntityManager::EntityManager()
 {
-    return root.addNode({ handle }, { desiredParent });
+    // Chunks are allocated on first use, see allocateChunk().
 }
 
-void Velox::EntityTreeView::updateEntities(const double& deltaTime)
+Velox::EntityManager::~EntityManager()
 {
-    root.update(deltaTime, nullptr, true);
-}
+    for (u32 c = 0; c < chunkCount; c++)
+        delete chunks[c];
 
-//
-// EntityManager 
-//
+    for (Velox::DrawList* list : chunkDrawLists)
+        Velox::destroyDrawList(list);
+}
 
-Velox::EntityManager::EntityManager()
+bool Velox::EntityManager::allocateChunk()
 {
-    for (uint32_t i = 0; i < MAX_ENTITIES; ++i)
+    if (chunkCount >= MAX_ENTITY_CHUNKS)
+        return false;
+
+    Velox::EntityChunk* chunk = new Velox::EntityChunk();
+
+    for (u32 slot = 0; slot < ENTITY_CHUNK_SIZE; slot++)
     {
-        freeIndices[i] = MAX_ENTITIES - i - 1;
-        generations[i] = 1;
+        chunk->generations[slot] = 1;
+        chunk->flags[slot]       = Velox::EntityFlags::None;
     }
+
+    for (u32 word = 0; word < ENTITY_ALIVE_WORDS; word++)
+        chunk->alive[word] = 0;
+
+    const u32 base = chunkCount * ENTITY_CHUNK_SIZE;
+
+    chunks[chunkCount] = chunk;
+    chunkCount += 1;
+
+    // Push in reverse so lower indices get handed out first.
+    freeIndices.reserve(capacity());
+    for (u32 slot = ENTITY_CHUNK_SIZE; slot > 0; slot--)
+        freeIndices.push_back(base + slot - 1);
+
+    return true;
 }
 
-// TODO: Allow child entities to be created before thier parent. 
-Velox::EntityHandle Velox::EntityManager::createEntity(const Velox::EntityHandle& parent)
+Velox::EntityHandle Velox::EntityManager::allocateEntity()
 {
-    if (freeIndicesCount <= 0)
+    if (freeIndices.empty() && !allocateChunk())
     {
         LOG_WARN("Entity pool exhausted");
         return {};
     }
 
-    freeIndicesCount -= 1;
-    uint32_t index = freeIndices[freeIndicesCount];
-    entities[index] = { makeHandle(index) };
-    entities[index].parent = parent;
+    uint32_t index = freeIndices.back();
+    freeIndices.pop_back();
 
-    isTreeDirty = true;
+    Velox::EntityChunk* chunk = chunkOf(index);
+    const u32 slot = index & ENTITY_CHUNK_MASK;
 
-    return entities[index].id;
+    chunk->entities[slot] = { makeHandle(index) };
+    chunk->entities[slot].manager = this;
+
+    chunk->flags[slot]              = Velox::EntityFlags::Updates;
+    chunk->positions[slot]          = vec3(0.0f);
+    chunk->rotations[slot]          = 0.0f;
+    chunk->scales[slot]             = vec2(1.0f);
+    chunk->absoluteTransforms[slot] = {};
+    chunk->colliders[slot]          = { 0.0f, 0.0f, 1.0f, 1.0f };
+    chunk->renderData[slot]         = {};
+
+    chunk->alive[slot >> 6] |= (u64(1) << (slot & 63));
+    aliveCount += 1;
+
+    return chunk->entities[slot].id;
 }
 
-Velox::Entity* Velox::EntityManager::getCreateEntity(const Velox::EntityHandle& parent)
+Velox::EntityHandle Velox::EntityManager::createEntity(const Velox::EntityHandle& parent)
 {
-    if (freeIndicesCount <= 0)
+    if (isUpdatingInParallel)
     {
-        LOG_WARN("Entity pool exhausted");
+        LOG_WARN("Can't create entities during a parallel update, use commands().createEntity()");
         return {};
     }
 
-    freeIndicesCount -= 1;
-    uint32_t index = freeIndices[freeIndicesCount];
-    entities[index] = { makeHandle(index)};
-    entities[index].parent = parent;
+    const Velox::EntityHandle handle = allocateEntity();
+    if (!handle.isValid())
+        return {};
 
-    isTreeDirty = true;
+    Velox::Entity& entity = chunkOf(handle.index)->entities[handle.index & ENTITY_CHUNK_MASK];
 
-    return &entities[index];
+    u32 parentPosition = HIERARCHY_NONE;
+    if (parent.isValid())
+    {
+        if (isAlive(parent))
+        {
+            parentPosition = hierarchyPositionOf(parent.index);
+            entity.parent = parent;
+        }
+        else
+        {
+            LOG_WARN("Parent entity {} is not alive, creating entity at top level", parent.index);
+        }
+    }
+
+    Velox::EntityHierarchyEntry entry { handle };
+    insertIntoHierarchy(&entry, 1, parentPosition);
+    markTransformDirty(handle.index);
+
+    return handle;
+}
+
+Velox::Entity* Velox::EntityManager::getCreateEntity(const Velox::EntityHandle& parent)
+{
+    return getMut(createEntity(parent));
 }
 
 Velox::EntityHandle Velox::EntityManager::makeHandle(uint32_t index) const
 {
-    return Velox::EntityHandle { index, generations[index] };
+    return Velox::EntityHandle { index, chunkOf(index)->generations[index & ENTITY_CHUNK_MASK] };
 }
 
 Velox::Entity& Velox::EntityManager::get(Velox::EntityHandle handle)
@@ -265,7 +235,7 @@ Velox::Entity& Velox::EntityManager::get(Velox::EntityHandle handle)
     if (!isAlive(handle))
         LOG_WARN("Non-alive entity queried!");
 
-    return entities[handle.index];
+    return chunkOf(handle.index)->entities[handle.index & ENTITY_CHUNK_MASK];
 }
 
 Velox::Entity* Velox::EntityManager::getMut(Velox::EntityHandle handle)
@@ -273,17 +243,32 @@ Velox::Entity* Velox::EntityManager::getMut(Velox::EntityHandle handle)
     if (!isAlive(handle))
         return nullptr;
 
-    return &entities[handle.index];
+    return &chunkOf(handle.index)->entities[handle.index & ENTITY_CHUNK_MASK];
 }
 
 void Velox::EntityManager::destroyEntity(const Velox::EntityHandle& handle)
 {
+    if (isUpdatingInParallel)
+    {
+        commands().destroyEntity(handle);
+        return;
+    }
+
     if (!isAlive(handle))
         return;
 
-    treeView.root.destroyChildren(handle);
+    const u32 position = hierarchyPositionOf(handle.index);
+    const u32 end      = position + hierarchy[position].subtreeSize;
+
+    // Mark for death, wait until end of frame to remove.
+    for (u32 pos = position; pos < end; pos++)
+    {
+        const Velox::EntityHandle& child = hierarchy[pos].handle;
+        if (isAlive(child))
+            chunkOf(child.index)->flags[child.index & ENTITY_CHUNK_MASK] |= Velox::EntityFlags::Dead;
+    }
 
-    isTreeDirty = true;
+    isHierarchyDirty = true;
 }
 
 void Velox::EntityManager::destroyEntityInternal(const Velox::EntityHandle& handle)
@@ -291,92 +276,943 @@ void Velox::EntityManager::destroyEntityInternal(const Velox::EntityHandle& hand
     if (!isAlive(handle))
         return;
 
-    generations[handle.index] += 1; // Invalidate stale handles;
-    freeIndices[freeIndicesCount] = handle.index;
-    freeIndicesCount += 1;
+    Velox::EntityChunk* chunk = chunkOf(handle.index);
+    const u32 slot = handle.index & ENTITY_CHUNK_MASK;
+
+    chunk->generations[slot] += 1; // Invalidate stale handles;
+    chunk->flags[slot] = Velox::EntityFlags::None;
+    chunk->alive[slot >> 6] &= ~(u64(1) << (slot & 63));
+    freeIndices.push_back(handle.index);
+    aliveCount -= 1;
+
+    // Entry stays in the hierarchy until the next compaction.
+    isHierarchyDirty = true;
 }
 
 void Velox::EntityManager::destroyAllEntities()
 {
-    for (u32 i = 0; i < MAX_ENTITIES; i++)
+    // Keep allocated chunks around, they will just get reused.
+    freeIndices.clear();
+
+    for (u32 c = chunkCount; c > 0; c--)
     {
-        entities[i]      = {};
-        freeIndices[i]   = MAX_ENTITIES - i - 1;
-        generations[i]  += 1;
-        freeIndicesCount = MAX_ENTITIES;
+        Velox::EntityChunk* chunk = chunks[c - 1];
+        const u32 base = (c - 1) * ENTITY_CHUNK_SIZE;
+
+        for (u32 word = 0; word < ENTITY_ALIVE_WORDS; word++)
+            chunk->alive[word] = 0;
+
+        for (u32 slot = ENTITY_CHUNK_SIZE; slot > 0; slot--)
+        {
+            chunk->entities[slot - 1]     = {};
+            chunk->flags[slot - 1]        = Velox::EntityFlags::None;
+            chunk->generations[slot - 1] += 1;
+            freeIndices.push_back(base + slot - 1);
+        }
     }
 
-    isTreeDirty = true;
+    aliveCount = 0;
+
+    hierarchy.clear();
+    isHierarchyDirty = false;
+
+    for (Velox::EntityCommandBuffer& buffer : threadCommandBuffers)
+        buffer.clear();
+
+    colliderRects.clear();
+    colliderHandles.clear();
+    collisionGrid.build(nullptr, 0);
 }
 
-void Velox::EntityManager::updateEntities(double& deltaTime)
+void Velox::EntityManager::setParent(const Velox::EntityHandle& handle, const Velox::EntityHandle& parent)
 {
-    treeView.updateEntities(deltaTime);
+    if (isUpdatingInParallel)
+    {
+        commands().setParent(handle, parent);
+        return;
+    }
+
+    Velox::Entity* entity = getMut(handle);
+    if (entity == nullptr)
+        return;
+
+    if (parent.isValid() && !isAlive(parent))
+    {
+        LOG_WARN("Can't parent entity {} to non-alive entity {}", handle.index, parent.index);
+        return;
+    }
+
+    const u32 position = hierarchyPositionOf(handle.index);
+    const u32 count    = hierarchy[position].subtreeSize;
+
+    if (parent.isValid())
+    {
+        const u32 parentPosition = hierarchyPositionOf(parent.index);
+        if (parentPosition >= position && parentPosition < position + count)
+        {
+            LOG_WARN("Can't parent entity {} to itself or one of its children", handle.index);
+            return;
+        }
+    }
+
+    removeFromHierarchy(position, count, &hierarchyScratch);
+
+    // Parent may have shifted down by the removal.
+    const u32 parentPosition = parent.isValid() ? hierarchyPositionOf(parent.index) : HIERARCHY_NONE;
+    insertIntoHierarchy(hierarchyScratch.data(), count, parentPosition);
+
+    entity->parent = parent;
+
+    // Relative to a new parent now. Cleared first so the new ancestors get SubtreeDirty.
+    entity->flags() &= ~Velox::EntityFlags::TransformDirty;
+    markTransformDirty(handle.index);
 }
 
-void Velox::EntityManager::drawEntities()
+u32 Velox::EntityManager::insertIntoHierarchy(const Velox::EntityHierarchyEntry* entries, u32 count, u32 parentPosition)
 {
-    for (std::pair<EntityHandle, Entity*> pair : iter())
-        pair.second->draw();
+    const u32 at = parentPosition == HIERARCHY_NONE
+        ? static_cast<u32>(hierarchy.size())
+        : parentPosition + hierarchy[parentPosition].subtreeSize;
+
+    hierarchy.insert(hierarchy.begin() + at, entries, entries + count);
+
+    hierarchy[at].parent = parentPosition;
+    for (u32 pos = at + 1; pos < at + count; pos++)
+        hierarchy[pos].parent += at;
+
+    // Everything after the gap moved up by count, including parents that were at or after it.
+    for (u32 pos = at + count; pos < hierarchy.size(); pos++)
+    {
+        u32& entryParent = hierarchy[pos].parent;
+        if (entryParent != HIERARCHY_NONE && entryParent >= at)
+            entryParent += count;
+    }
+
+    for (u32 pos = at; pos < hierarchy.size(); pos++)
+    {
+        // Stale entries may share a slot with a new entity, don't clobber its position.
+        if (isAlive(hierarchy[pos].handle))
+            hierarchyPositionOf(hierarchy[pos].handle.index) = pos;
+    }
+
+    // Ancestors are all before the gap so they haven't moved.
+    for (u32 pos = parentPosition; pos != HIERARCHY_NONE; pos = hierarchy[pos].parent)
+        hierarchy[pos].subtreeSize += count;
+
+    return at;
 }
 
-void Velox::EntityManager::postFrameUpdates()
+void Velox::EntityManager::insertIntoHierarchy(std::vector<Velox::EntityHierarchyInsert>* inserts, const Velox::EntityHierarchyEntry* entries)
 {
-    for (i32 i = MAX_ENTITIES - 1; i >= 0; i--)
+    bool topLevelOnly = true;
+    for (const Velox::EntityHierarchyInsert& insert : *inserts)
+        topLevelOnly &= insert.parentPosition == HIERARCHY_NONE;
+
+    // Appending doesn't move anything, so it only costs the new entries.
+    if (topLevelOnly)
+    {
+        for (Velox::EntityHierarchyInsert& insert : *inserts)
+            insert.at = insertIntoHierarchy(entries + insert.first, insert.count, HIERARCHY_NONE);
+        return;
+    }
+
+    const u32 oldSize = static_cast<u32>(hierarchy.size());
+
+    u32 insertedCount = 0;
+    for (Velox::EntityHierarchyInsert& insert : *inserts)
     {
-        if (entities[i].hasFlag(Velox::EntityFlags::Dead))
+        insert.at = insert.parentPosition == HIERARCHY_NONE
+            ? oldSize
+            : insert.parentPosition + hierarchy[insert.parentPosition].subtreeSize;
+        insertedCount += insert.count;
+    }
+
+    // When subtrees end at the same place the deepest parent goes first, so its new children
+    // stay inside its subtree. Top level ones are the shallowest of all.
+    auto depthKey = [](u32 parentPosition) { return parentPosition == HIERARCHY_NONE ? 0 : parentPosition + 1; };
+    std::stable_sort(inserts->begin(), inserts->end(),
+            [&depthKey](const Velox::EntityHierarchyInsert& a, const Velox::EntityHierarchyInsert& b)
+    {
+        if (a.at != b.at)
+            return a.at < b.at;
+        return depthKey(a.parentPosition) > depthKey(b.parentPosition);
+    });
+
+    hierarchyScratch.resize(oldSize + insertedCount);
+    hierarchyRemap.resize(oldSize);
+
+    u32 write = 0;
+    size_t next = 0;
+    for (u32 pos = 0; pos <= oldSize; pos++)
+    {
+        for (; next < inserts->size() && (*inserts)[next].at == pos; next++)
         {
-            destroyEntityInternal(entities[i].id);
-            isTreeDirty = true;
+            Velox::EntityHierarchyInsert& insert = (*inserts)[next];
+
+            for (u32 i = 0; i < insert.count; i++)
+            {
+                Velox::EntityHierarchyEntry entry = entries[insert.first + i];
+                if (i != 0)
+                    entry.parent += write;
+
+                hierarchyScratch[write + i] = entry;
+            }
+
+            insert.at = write;
+            write += insert.count;
         }
+
+        if (pos == oldSize)
+            break;
+
+        hierarchyRemap[pos] = write;
+        hierarchyScratch[write] = hierarchy[pos];
+        write += 1;
+    }
+
+    hierarchy.swap(hierarchyScratch);
+
+    // Parents of old entries, they only ever moved up.
+    for (u32 pos = 0; pos < oldSize; pos++)
+    {
+        u32& entryParent = hierarchy[hierarchyRemap[pos]].parent;
+        if (entryParent != HIERARCHY_NONE)
+            entryParent = hierarchyRemap[entryParent];
+    }
+
+    for (const Velox::EntityHierarchyInsert& insert : *inserts)
+    {
+        const u32 parentPosition = insert.parentPosition == HIERARCHY_NONE ? HIERARCHY_NONE : hierarchyRemap[insert.parentPosition];
+        hierarchy[insert.at].parent = parentPosition;
+
+        for (u32 pos = parentPosition; pos != HIERARCHY_NONE; pos = hierarchy[pos].parent)
+            hierarchy[pos].subtreeSize += insert.count;
+    }
+
+    for (u32 pos = 0; pos < hierarchy.size(); pos++)
+    {
+        if (isAlive(hierarchy[pos].handle))
+            hierarchyPositionOf(hierarchy[pos].handle.index) = pos;
+    }
+}
+
+void Velox::EntityManager::removeFromHierarchy(u32 position, u32 count, std::vector<Velox::EntityHierarchyEntry>* removed)
+{
+    const u32 parentPosition = hierarchy[position].parent;
+
+    if (removed != nullptr)
+    {
+        removed->assign(hierarchy.begin() + position, hierarchy.begin() + position + count);
+        for (u32 i = 1; i < count; i++)
+            (*removed)[i].parent -= position;
     }
 
-    generateTreeView();
+    hierarchy.erase(hierarchy.begin() + position, hierarchy.begin() + position + count);
+
+    // The removed range is a whole subtree, so nothing after it can have a parent inside it.
+    for (u32 pos = position; pos < hierarchy.size(); pos++)
+    {
+        u32& entryParent = hierarchy[pos].parent;
+        if (entryParent != HIERARCHY_NONE && entryParent > position)
+            entryParent -= count;
+
+        if (isAlive(hierarchy[pos].handle))
+            hierarchyPositionOf(hierarchy[pos].handle.index) = pos;
+    }
+
+    for (u32 pos = parentPosition; pos != HIERARCHY_NONE; pos = hierarchy[pos].parent)
+        hierarchy[pos].subtreeSize -= count;
 }
 
-void Velox::EntityManager::generateTreeView(bool forceUpdate)
+void Velox::EntityManager::compactHierarchy()
 {
-    if (!isTreeDirty && !forceUpdate)
+    hierarchyRemap.resize(hierarchy.size());
+
+    u32 write = 0;
+    for (u32 pos = 0; pos < hierarchy.size(); pos++)
+    {
+        Velox::EntityHierarchyEntry entry = hierarchy[pos];
+
+        // Parents come first, so their remap is already known.
+        const u32 newParent = entry.parent == HIERARCHY_NONE ? HIERARCHY_NONE : hierarchyRemap[entry.parent];
+        const bool parentRemoved = entry.parent != HIERARCHY_NONE && newParent == HIERARCHY_NONE;
+
+        if (!isAlive(entry.handle) || parentRemoved ||
+            (chunkOf(entry.handle.index)->flags[entry.handle.index & ENTITY_CHUNK_MASK] & Velox::EntityFlags::Dead) != 0)
+        {
+            // Children go with their parent.
+            destroyEntityInternal(entry.handle);
+            hierarchyRemap[pos] = HIERARCHY_NONE;
+            continue;
+        }
+
+        entry.parent      = newParent;
+        entry.subtreeSize = 1;
+
+        hierarchyRemap[pos] = write;
+        hierarchyPositionOf(entry.handle.index) = write;
+        hierarchy[write] = entry;
+        write += 1;
+    }
+
+    hierarchy.resize(write);
+
+    // Children come after parents, so walking backwards sums each subtree before it's added to its parent.
+    for (u32 pos = write; pos > 0; pos--)
+    {
+        const Velox::EntityHierarchyEntry& entry = hierarchy[pos - 1];
+        if (entry.parent != HIERARCHY_NONE)
+            hierarchy[entry.parent].subtreeSize += entry.subtreeSize;
+    }
+
+    isHierarchyDirty = false;
+}
+
+void Velox::EntityManager::markTransformDirty(uint32_t index)
+{
+    u32& entityFlags = chunkOf(index)->flags[index & ENTITY_CHUNK_MASK];
+    if ((entityFlags & Velox::EntityFlags::TransformDirty) != 0)
         return;
 
-    treeView.root = {};
+    entityFlags |= Velox::EntityFlags::TransformDirty;
 
-    for (std::pair<EntityHandle, Entity*> pair : iter())
+    // Stops at the first ancestor that is already marked, everything above it is too.
+    for (u32 pos = hierarchy[hierarchyPositionOf(index)].parent; pos != HIERARCHY_NONE; pos = hierarchy[pos].parent)
     {
-        bool result = treeView.addNode(pair.first, pair.second->parent);
-        if (!result)
-            LOG_WARN("Failed to add entity to tree view, parent '{}' not found", pair.second->parent);
+        const uint32_t ancestor = hierarchy[pos].handle.index;
+        u32& ancestorFlags = chunkOf(ancestor)->flags[ancestor & ENTITY_CHUNK_MASK];
+
+        if ((ancestorFlags & Velox::EntityFlags::SubtreeDirty) != 0)
+            break;
+
+        ancestorFlags |= Velox::EntityFlags::SubtreeDirty;
     }
+}
 
-    isTreeDirty = false;
+static void updateSubtree(Velox::EntityManager* manager, u32 position, const double& deltaTime)
+{
+    const u32 end = position + manager->hierarchy[position].subtreeSize;
+    for (u32 pos = position; pos < end; pos++)
+    {
+        Velox::Entity* entity = manager->getMut(manager->hierarchy[pos].handle);
+        if (entity == nullptr || !entity->hasFlag(Velox::EntityFlags::Updates))
+            continue;
+
+        entity->update(deltaTime);
+    }
 }
 
-void Velox::EntityManager::getTreeViewHandlesAsVector(std::vector<EntityHandle>* handles)
+void Velox::EntityManager::updateEntities(const double& deltaTime)
 {
-    LOG_WARN("NOT IMPLEMENTED");   
+    updateTransforms();
+    updateBroadphase();
+
+    parallelRoots.clear();
+    if (parallelUpdates)
+    {
+        // Top level entries only, stepping over whole subtrees.
+        for (u32 pos = 0; pos < hierarchy.size(); pos += hierarchy[pos].subtreeSize)
+        {
+            const Velox::EntityHandle& handle = hierarchy[pos].handle;
+            if (isAlive(handle) && (chunkOf(handle.index)->flags[handle.index & ENTITY_CHUNK_MASK] & Velox::EntityFlags::ThreadSafe) != 0)
+                parallelRoots.push_back(pos);
+        }
+    }
+
+    if (!parallelRoots.empty())
+    {
+        // Make sure every thread has a buffer before any of them start recording.
+        commands();
+
+        // Structural changes are deferred from here on, so the hierarchy stays put.
+        isUpdatingInParallel = true;
+
+        // A few batches per thread so uneven subtrees even out through stealing.
+        const u32 rootCount = static_cast<u32>(parallelRoots.size());
+        const u32 batchSize = std::max(1u, rootCount / (Velox::getJobThreadCount() * 4));
+
+        Velox::parallelFor(0, rootCount, batchSize, [this, &deltaTime](u32 begin, u32 end)
+        {
+            for (u32 i = begin; i < end; i++)
+                updateSubtree(this, parallelRoots[i], deltaTime);
+        });
+
+        isUpdatingInParallel = false;
+    }
+
+    // Update functions are free to create, destroy and reparent entities, so walk a copy.
+    updateOrder.clear();
+    u32 nextParallelRoot = 0;
+    for (u32 pos = 0; pos < hierarchy.size(); pos++)
+    {
+        if (nextParallelRoot < parallelRoots.size() && parallelRoots[nextParallelRoot] == pos)
+        {
+            // Already updated.
+            pos += hierarchy[pos].subtreeSize - 1;
+            nextParallelRoot += 1;
+            continue;
+        }
+
+        updateOrder.push_back(hierarchy[pos].handle);
+    }
+
+    for (const Velox::EntityHandle& handle : updateOrder)
+    {
+        Velox::Entity* entity = getMut(handle);
+        if (entity == nullptr || !entity->hasFlag(Velox::EntityFlags::Updates))
+            continue;
+
+        entity->update(deltaTime);
+    }
 }
 
-void Velox::EntityManager::getTreeViewEntitiesAsVector(std::vector<Entity*>* handles)
+void Velox::EntityManager::updateTransforms()
 {
-    LOG_WARN("NOT IMPLEMENTED");   
+    transformsRecomputed = 0;
+    transformWritten.resize(hierarchy.size());
+
+    // Parents come before their children, so a parents absolute transform is always
+    // up to date by the time its children read it.
+    u32 pos = 0;
+    while (pos < hierarchy.size())
+    {
+        const Velox::EntityHierarchyEntry& entry = hierarchy[pos];
+        const bool parentWritten = entry.parent != HIERARCHY_NONE && transformWritten[entry.parent];
+
+        // Destroyed since the last compaction, its children still follow the parent.
+        if (!isAlive(entry.handle))
+        {
+            transformWritten[pos] = parentWritten;
+            pos += 1;
+            continue;
+        }
+
+        u32& entityFlags = chunkOf(entry.handle.index)->flags[entry.handle.index & ENTITY_CHUNK_MASK];
+
+        // Static ones only move when they're moved themselves.
+        const bool moved = (entityFlags & Velox::EntityFlags::TransformDirty) != 0
+            || (parentWritten && (entityFlags & Velox::EntityFlags::Static) == 0);
+
+        if (moved)
+        {
+            const Velox::EntityTransform* parentTransform = nullptr;
+            if (entry.parent != HIERARCHY_NONE)
+            {
+                const uint32_t parentIndex = hierarchy[entry.parent].handle.index;
+                parentTransform = &chunkOf(parentIndex)->absoluteTransforms[parentIndex & ENTITY_CHUNK_MASK];
+            }
+
+            updateTransform(entry.handle.index, parentTransform);
+            entityFlags &= ~(Velox::EntityFlags::TransformDirty | Velox::EntityFlags::SubtreeDirty);
+
+            transformsRecomputed += 1;
+            transformWritten[pos] = true;
+            pos += 1;
+            continue;
+        }
+
+        transformWritten[pos] = false;
+
+        if ((entityFlags & Velox::EntityFlags::SubtreeDirty) != 0)
+        {
+            // Clean itself, but something below isn't.
+            entityFlags &= ~Velox::EntityFlags::SubtreeDirty;
+            pos += 1;
+            continue;
+        }
+
+        // Nothing changed in here, static geometry should mostly end up here.
+        pos += entry.subtreeSize;
+    }
+}
+
+void Velox::EntityManager::cullSprites(const Velox::Rectangle& view)
+{
+    spriteBounds.minX.clear();
+    spriteBounds.minY.clear();
+    spriteBounds.maxX.clear();
+    spriteBounds.maxY.clear();
+    chunkFirstSprite.resize(chunkCount);
+
+    for (u32 c = 0; c < chunkCount; c++)
+    {
+        chunkFirstSprite[c] = spriteBounds.size();
+
+        forEachAliveSlotInChunk(c, [this](Velox::EntityChunk* chunk, u32 slot, uint32_t)
+        {
+            if ((chunk->flags[slot] & Velox::EntityFlags::Visible) == 0 || chunk->entities[slot].drawFunction != nullptr)
+                return;
+
+            // Same quad drawEntitySprite() draws, rotated around its center.
+            const Velox::EntityTransform& transform = chunk->absoluteTransforms[slot];
+
+            vec2 center = vec2(transform.position);
+            if ((chunk->flags[slot] & Velox::EntityFlags::DrawFromCenter) == 0)
+                center += transform.scale * 0.5f;
+
+            vec2 halfSize = glm::abs(transform.scale) * 0.5f;
+            if (transform.rotation != 0.0f)
+            {
+                const f32 sin = std::abs(std::sin(glm::radians(transform.rotation)));
+                const f32 cos = std::abs(std::cos(glm::radians(transform.rotation)));
+                halfSize = vec2(halfSize.x * cos + halfSize.y * sin, halfSize.x * sin + halfSize.y * cos);
+            }
+
+            spriteBounds.minX.push_back(center.x - halfSize.x);
+            spriteBounds.minY.push_back(center.y - halfSize.y);
+            spriteBounds.maxX.push_back(center.x + halfSize.x);
+            spriteBounds.maxY.push_back(center.y + halfSize.y);
+        });
+    }
+
+    const u32 spriteCount = spriteBounds.size();
+    spriteVisibleMask.resize((spriteCount + 63) / 64);
+
+    if (!spriteCulling)
+    {
+        std::fill(spriteVisibleMask.begin(), spriteVisibleMask.end(), ~0ull);
+        spritesSubmitted = spriteCount;
+        spritesCulled    = 0;
+        return;
+    }
+
+    // SIMD kernels, 4 or 8 sprites per test.
+    if (spriteCount > 0)
+        Velox::overlapMask(view, spriteBounds, spriteVisibleMask.data());
+
+    spritesSubmitted = 0;
+    for (u64 word : spriteVisibleMask)
+        spritesSubmitted += Velox::countSetBits(word);
+
+    spritesCulled = spriteCount - spritesSubmitted;
+}
+
+void Velox::EntityManager::drawEntities()
+{
+    // Entities are drawn through the camera of the current layer.
+    cullSprites(Velox::getViewBounds(Velox::getDrawLayerCamera(Velox::getDrawLayer())));
+
+    if (!parallelDraws || chunkCount <= 1)
+    {
+        u32 sprite = 0;
+        forEachRenderable([this, &sprite](Velox::EntityHandle handle, u32 entityFlags,
+                    const Velox::EntityTransform& absolute, const Velox::EntityRenderData& render)
+        {
+            // Custom draw functions get the full entity, everything else only needs the columns.
+            Velox::Entity& entity = chunkOf(handle.index)->entities[handle.index & ENTITY_CHUNK_MASK];
+            if (entity.drawFunction != nullptr)
+            {
+                entity.drawFunction(entity);
+                return;
+            }
+
+            if (isSpriteVisible(sprite++))
+                drawEntitySprite(entityFlags, absolute, render);
+        });
+
+        return;
+    }
+
+    while (chunkDrawLists.size() < chunkCount)
+        chunkDrawLists.push_back(Velox::createDrawList("Entity Chunk"));
+    chunkDeferredDraws.resize(chunkCount);
+
+    // Draw lists start out on the default layer, the chunks go where the serial path would draw them.
+    const u8 layer = Velox::getDrawLayer();
+
+    Velox::parallelFor(0, chunkCount, 1, [this, layer](u32 begin, u32 end)
+    {
+        for (u32 c = begin; c < end; c++)
+        {
+            Velox::DrawList* list = chunkDrawLists[c];
+            std::vector<std::pair<u32, Velox::EntityHandle>>& deferred = chunkDeferredDraws[c];
+            deferred.clear();
+
+            Velox::beginDrawList(list);
+            Velox::setDrawLayer(layer);
+
+            u32 sprite = chunkFirstSprite[c];
+            forEachAliveSlotInChunk(c, [&](Velox::EntityChunk* chunk, u32 slot, uint32_t index)
+            {
+                const u32 entityFlags = chunk->flags[slot];
+                if ((entityFlags & Velox::EntityFlags::Visible) == 0)
+                    return;
+
+                Velox::Entity& entity = chunk->entities[slot];
+                if (entity.drawFunction == nullptr)
+                {
+                    if (isSpriteVisible(sprite++))
+                        drawEntitySprite(entityFlags, chunk->absoluteTransforms[slot], chunk->renderData[slot]);
+                    return;
+                }
+
+                if ((entityFlags & Velox::EntityFlags::ThreadSafeDraw) == 0)
+                {
+                    deferred.push_back({ Velox::getDrawListSize(list), Velox::EntityHandle { index, chunk->generations[slot] } });
+                    return;
+                }
+
+                entity.drawFunction(entity);
+            });
+
+            Velox::endDrawList();
+        }
+    });
+
+    // Chunk order is index order, the same order forEachRenderable() draws in.
+    for (u32 c = 0; c < chunkCount; c++)
+    {
+        u32 submitted = 0;
+        for (const auto& [position, handle] : chunkDeferredDraws[c])
+        {
+            Velox::submitDrawList(chunkDrawLists[c], submitted, position);
+            submitted = position;
+
+            Velox::Entity& entity = chunkOf(handle.index)->entities[handle.index & ENTITY_CHUNK_MASK];
+            entity.drawFunction(entity);
+        }
+
+        Velox::submitDrawList(chunkDrawLists[c], submitted);
+    }
+}
+
+void Velox::EntityManager::updateBroadphase()
+{
+    colliderRects.clear();
+    colliderHandles.clear();
+
+    forEachCollider([this](Velox::EntityHandle handle, const Velox::Rectangle& collider)
+    {
+        colliderRects.push_back(collider);
+        colliderHandles.push_back(handle);
+    });
+
+    collisionGrid.build(colliderRects.data(), static_cast<u32>(colliderRects.size()));
+}
+
+void Velox::EntityManager::queryOverlaps(const Velox::Rectangle& rect, std::vector<EntityHandle>* overlaps, const EntityHandle& ignore)
+{
+    // Per thread so queries from update functions don't share it.
+    static thread_local std::vector<u32> s_hits;
+    s_hits.clear();
+
+    collisionGrid.query(rect, &s_hits);
+
+    for (u32 hit : s_hits)
+    {
+        const Velox::EntityHandle& handle = colliderHandles[hit];
+
+        // Could have died since the broadphase was built.
+        if (handle != ignore && isAlive(handle))
+            overlaps->push_back(handle);
+    }
+}
+
+void Velox::EntityManager::getOverlappingPairs(std::vector<std::pair<EntityHandle, EntityHandle>>* pairs)
+{
+    static thread_local std::vector<std::pair<u32, u32>> s_pairs;
+    s_pairs.clear();
+
+    collisionGrid.queryPairs(&s_pairs);
+
+    for (const std::pair<u32, u32>& pair : s_pairs)
+    {
+        const Velox::EntityHandle& first  = colliderHandles[pair.first];
+        const Velox::EntityHandle& second = colliderHandles[pair.second];
+
+        if (isAlive(first) && isAlive(second))
+            pairs->push_back({ first, second });
+    }
+}
+
+Velox::EntityCommandBuffer& Velox::EntityManager::commands()
+{
+    // Only grows from the main thread, updateEntities() sizes it before going parallel.
+    const u32 threadCount = Velox::getJobThreadCount();
+    if (threadCommandBuffers.size() < threadCount)
+        threadCommandBuffers.resize(threadCount);
+
+    return threadCommandBuffers[Velox::getJobThreadIndex()];
+}
+
+void Velox::EntityManager::applyCommands(Velox::EntityCommandBuffer* buffers, u32 count)
+{
+    // onCreate callbacks and the commands themselves may record more, so go until nothing is left.
+    while (true)
+    {
+        // Taken out of the buffers first so anything recorded from here on goes to the next round.
+        pendingCommands.clear();
+        for (u32 b = 0; b < count; b++)
+        {
+            const u32 base = static_cast<u32>(pendingCommands.size());
+
+            for (Velox::EntityCommand& command : buffers[b].commands)
+            {
+                // Placeholders index into their own buffer.
+                if (command.handle.generation == ENTITY_PENDING_GENERATION) command.handle.index += base;
+                if (command.parent.generation == ENTITY_PENDING_GENERATION) command.parent.index += base;
+
+                pendingCommands.push_back(std::move(command));
+            }
+
+            buffers[b].clear();
+        }
+
+        if (pendingCommands.empty())
+            return;
+
+        const u32 commandCount = static_cast<u32>(pendingCommands.size());
+        commandHandles.assign(commandCount, {});
+
+        auto resolve = [this](const Velox::EntityHandle& handle) -> Velox::EntityHandle
+        {
+            return handle.generation == ENTITY_PENDING_GENERATION ? commandHandles[handle.index] : handle;
+        };
+
+        // Creates. Entities whose parent is also new are collected into that parents subtree,
+        // so every new subtree goes in with a single insert.
+        createFirstChild.assign(commandCount, HIERARCHY_NONE);
+        createNextSibling.assign(commandCount, HIERARCHY_NONE);
+        createLastChild.assign(commandCount, HIERARCHY_NONE);
+
+        for (u32 i = 0; i < commandCount; i++)
+        {
+            Velox::EntityCommand& command = pendingCommands[i];
+            if (command.type != Velox::EntityCommandType::Create)
+                continue;
+
+            commandHandles[i] = allocateEntity();
+            if (!commandHandles[i].isValid())
+                continue;
+
+            const Velox::EntityHandle parent = resolve(command.parent);
+            if (command.parent.isValid() && !isAlive(parent))
+            {
+                LOG_WARN("Parent entity {} is not alive, creating entity at top level", parent.index);
+                command.parent = {};
+                continue;
+            }
+
+            get(commandHandles[i]).parent = parent;
+
+            if (command.parent.generation != ENTITY_PENDING_GENERATION)
+                continue;
+
+            const u32 parentCommand = command.parent.index;
+            if (createLastChild[parentCommand] == HIERARCHY_NONE)
+                createFirstChild[parentCommand] = i;
+            else
+                createNextSibling[createLastChild[parentCommand]] = i;
+            createLastChild[parentCommand] = i;
+        }
+
+        insertEntries.clear();
+        inserts.clear();
+        for (u32 i = 0; i < commandCount; i++)
+        {
+            const Velox::EntityCommand& command = pendingCommands[i];
+            if (command.type != Velox::EntityCommandType::Create || !commandHandles[i].isValid())
+                continue;
+
+            // Picked up by its parents subtree.
+            if (command.parent.generation == ENTITY_PENDING_GENERATION)
+                continue;
+
+            Velox::EntityHierarchyInsert insert {};
+            insert.parentPosition = command.parent.isValid() ? hierarchyPositionOf(command.parent.index) : HIERARCHY_NONE;
+            insert.first = static_cast<u32>(insertEntries.size());
+
+            // Depth first, written in order, then sized from the back like compactHierarchy().
+            // parent is relative to insert.first while building.
+            // Stack of (command, relative parent), children pushed in reverse so they come out in order.
+            createStack.clear();
+            createStack.push_back({ i, HIERARCHY_NONE });
+
+            while (!createStack.empty())
+            {
+                const std::pair<u32, u32> item = createStack.back();
+                createStack.pop_back();
+
+                const u32 relative = static_cast<u32>(insertEntries.size()) - insert.first;
+                insertEntries.push_back({ commandHandles[item.first], item.second, 1 });
+
+                const size_t childrenStart = createStack.size();
+                for (u32 child = createFirstChild[item.first]; child != HIERARCHY_NONE; child = createNextSibling[child])
+                    createStack.push_back({ child, relative });
+                std::reverse(createStack.begin() + childrenStart, createStack.end());
+            }
+
+            insert.count = static_cast<u32>(insertEntries.size()) - insert.first;
+            for (u32 e = insert.count; e > 1; e--)
+            {
+                const Velox::EntityHierarchyEntry& entry = insertEntries[insert.first + e - 1];
+                insertEntries[insert.first + entry.parent].subtreeSize += entry.subtreeSize;
+            }
+
+            inserts.push_back(insert);
+        }
+
+        if (!inserts.empty())
+            insertIntoHierarchy(&inserts, insertEntries.data());
+
+        for (u32 i = 0; i < commandCount; i++)
+        {
+            if (pendingCommands[i].type == Velox::EntityCommandType::Create && commandHandles[i].isValid())
+                markTransformDirty(commandHandles[i].index);
+        }
+
+        for (u32 i = 0; i < commandCount; i++)
+        {
+            Velox::EntityCommand& command = pendingCommands[i];
+            if (command.type == Velox::EntityCommandType::Create && command.onCreate != nullptr && isAlive(commandHandles[i]))
+                command.onCreate(get(commandHandles[i]));
+        }
+
+        for (u32 i = 0; i < commandCount; i++)
+        {
+            const Velox::EntityCommand& command = pendingCommands[i];
+            const Velox::EntityHandle handle = resolve(command.handle);
+
+            switch (command.type)
+            {
+                case Velox::EntityCommandType::Create:
+                    break;
+                case Velox::EntityCommandType::Destroy:
+                    destroyEntity(handle);
+                    break;
+                case Velox::EntityCommandType::SetParent:
+                    setParent(handle, resolve(command.parent));
+                    break;
+                case Velox::EntityCommandType::SetFlag:
+                    if (isAlive(handle))
+                        get(handle).setFlag(static_cast<Velox::EntityFlags>(command.flag), command.state);
+                    break;
+            }
+        }
+    }
+}
+
+void Velox::EntityManager::postFrameUpdates()
+{
+    // Main thread first, then workers by index.
+    if (!threadCommandBuffers.empty())
+        applyCommands(threadCommandBuffers.data(), static_cast<u32>(threadCommandBuffers.size()));
+
+    // Entities can also be killed by setting the Dead flag directly.
+    if (!isHierarchyDirty)
+    {
+        for (const Velox::EntityHierarchyEntry& entry : hierarchy)
+        {
+            if ((chunkOf(entry.handle.index)->flags[entry.handle.index & ENTITY_CHUNK_MASK] & Velox::EntityFlags::Dead) != 0)
+            {
+                isHierarchyDirty = true;
+                break;
+            }
+        }
+    }
+
+    if (isHierarchyDirty)
+        compactHierarchy();
+}
+
+void Velox::EntityManager::getHierarchyHandlesAsVector(std::vector<EntityHandle>* handles)
+{
+    for (const Velox::EntityHierarchyEntry& entry : hierarchy)
+    {
+        if (isAlive(entry.handle))
+            handles->push_back(entry.handle);
+    }
+}
+
+void Velox::EntityManager::getHierarchyEntitiesAsVector(std::vector<Entity*>* entities)
+{
+    for (const Velox::EntityHierarchyEntry& entry : hierarchy)
+    {
+        Velox::Entity* entity = getMut(entry.handle);
+        if (entity != nullptr)
+            entities->push_back(entity);
+    }
+}
+
+void Velox::EntityManager::updateTransform(uint32_t index, const Velox::EntityTransform* parentTransform)
+{
+    Velox::EntityChunk* chunk = chunkOf(index);
+    const u32 slot = index & ENTITY_CHUNK_MASK;
+
+    Velox::EntityTransform& absolute = chunk->absoluteTransforms[slot];
+    const vec3& position = chunk->positions[slot];
+    const float rotation = chunk->rotations[slot];
+    const vec2& scale    = chunk->scales[slot];
+
+    if (parentTransform != nullptr)
+    {
+        // GM: This is kinda jank.
+        absolute.position = vec3(vec2(parentTransform->position) +
+            glm::rotate(vec2(position), glm::radians(parentTransform->rotation)), 0.0f);
+
+        absolute.rotation = glm::mod(parentTransform->rotation + rotation, 360.0f);
+        absolute.scale    = parentTransform->scale * scale;
+    }
+    else
+    {
+        absolute.position = position;
+        absolute.rotation = glm::mod(rotation, 360.0f);
+        absolute.scale    = scale;
+    }
+
+    Velox::Rectangle& collider = chunk->colliders[slot];
+    collider.x = absolute.position.x;
+    collider.y = absolute.position.y;
+    collider.w = absolute.scale.x;
+    collider.h = absolute.scale.y;
+
+    if ((chunk->flags[slot] & Velox::EntityFlags::CollideFromCenter) != 0)
+    {
+        collider.x -= scale.x / 2.0f;
+        collider.y -= scale.y / 2.0f;
+    }
 }
 
 bool Velox::EntityManager::isAlive(const Velox::EntityHandle& handle) const
 {
-    if (!handle.isValid())
+    if (!handle.isValid() || handle.index >= capacity())
         return false;
 
-    return generations[handle.index] == handle.generation;
+    return chunkOf(handle.index)->generations[handle.index & ENTITY_CHUNK_MASK] == handle.generation;
 }
 
 bool Velox::EntityManager::isIndexFree(uint32_t index) const
 {
-    for (size_t i = 0; i < freeIndicesCount; ++i) {
-        if (freeIndices[i] == index)
-            return true;
+    if (index >= capacity())
+        return true;
+
+    const u32 slot = index & ENTITY_CHUNK_MASK;
+    return (chunkOf(index)->alive[slot >> 6] & (u64(1) << (slot & 63))) == 0;
+}
+
+uint32_t Velox::EntityManager::nextAliveIndex(uint32_t index) const
+{
+    while (index < capacity())
+    {
+        const u32 slot = index & ENTITY_CHUNK_MASK;
+
+        // Mask off bits below index within its word.
+        u64 bits = chunkOf(index)->alive[slot >> 6] & (~u64(0) << (slot & 63));
+        if (bits != 0)
+            return (index & ~63u) + countTrailingZeros(bits);
+
+        index = (index & ~63u) + 64;
     }
 
-    return false;
+    return capacity();
+}
+
+void Velox::EntityManager::getMemoryUsage(size_t* used, size_t* capacity) const
+{
+    constexpr size_t bytesPerEntity = sizeof(Velox::EntityChunk) / ENTITY_CHUNK_SIZE;
+
+    if (used)     *used     = aliveCount * bytesPerEntity;
+    if (capacity) *capacity = chunkCount * sizeof(Velox::EntityChunk) + freeIndices.capacity() * sizeof(uint32_t);
 }
 
 //
@@ -396,8 +1232,7 @@ Velox::EntityManager::EntityIterable::Iterator::Iterator(Velox::EntityManager* m
 
 void Velox::EntityManager::EntityIterable::Iterator::skipDead()
 {
-    while (index < MAX_ENTITIES && manager->isIndexFree(index))
-        index += 1;
+    index = manager->nextAliveIndex(index);
 }
 
 bool Velox::EntityManager::EntityIterable::Iterator::operator!=(const Iterator& other) const
@@ -414,7 +1249,7 @@ void Velox::EntityManager::EntityIterable::Iterator::operator++()
 std::pair<Velox::EntityHandle, Velox::Entity*> Velox::EntityManager::EntityIterable::Iterator::operator*() const
 {
     EntityHandle handle = manager->makeHandle(index);
-    return std::pair<EntityHandle, Entity*> { handle, &manager->entities[index] };
+    return std::pair<EntityHandle, Entity*> { handle, &manager->chunkOf(index)->entities[index & ENTITY_CHUNK_MASK] };
 }
 
 Velox::EntityManager::EntityIterable::Iterator Velox::EntityManager::EntityIterable::begin()
@@ -424,6 +1259,6 @@ Velox::EntityManager::EntityIterable::Iterator Velox::EntityManager::EntityItera
 
 Velox::EntityManager::EntityIterable::Iterator Velox::EntityManager::EntityIterable::end()
 {
-    return Iterator { manager, MAX_ENTITIES };
+    return Iterator { manager, manager->capacity() };
 }
 
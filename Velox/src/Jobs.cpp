@@ -0,0 +1,281 @@
+#include "Jobs.h"
+#include <PCH.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct Job {
+    std::function<void()> function;
+    Velox::JobCounter* counter;
+    Velox::JobCounter* dependency;
+};
+
+struct JobQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+
+    // Only written by the owning thread, atomic so the stats can be read while running.
+    std::atomic<u64> executed { 0 };
+    std::atomic<u64> stolen   { 0 };
+};
+
+// Indexed by thread index, 0 is the main thread.
+static std::vector<std::unique_ptr<JobQueue>> s_queues;
+static std::vector<std::thread> s_workers;
+
+static std::atomic<u32>  s_queuedJobs { 0 };
+static std::atomic<u32>  s_sleepingWorkers { 0 };
+static std::atomic<bool> s_running { false };
+
+static std::mutex s_sleepMutex;
+static std::condition_variable s_wakeCondition;
+
+static thread_local u32 s_threadIndex = 0;
+
+static void pushJob(Job&& job, bool toFront = false)
+{
+    JobQueue& queue = *s_queues[s_threadIndex];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (toFront)
+            queue.jobs.push_front(std::move(job));
+        else
+            queue.jobs.push_back(std::move(job));
+    }
+
+    // Store then load on both sides (see workerLoop()), only seq_cst keeps a worker from going
+    // to sleep on a queued job without this seeing it.
+    s_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    if (s_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        // Taking the lock makes sure a worker that's about to sleep sees the new job.
+        { std::lock_guard<std::mutex> lock(s_sleepMutex); }
+        s_wakeCondition.notify_one();
+    }
+}
+
+static bool popJob(u32 threadIndex, Job* job, bool* stolen)
+{
+    const u32 threadCount = static_cast<u32>(s_queues.size());
+
+    // Own queue from the back (most recently pushed, likely still in cache),
+    // then others from the front (oldest, most likely to be a big chunk of work).
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        JobQueue& queue = *s_queues[(threadIndex + i) % threadCount];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+
+        if (i == 0)
+        {
+            *job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        else
+        {
+            *job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+
+        *stolen = i != 0;
+        s_queuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    return false;
+}
+
+// Returns false when there was nothing runnable.
+static bool runOneJob()
+{
+    Job job;
+    bool stolen;
+    if (!popJob(s_threadIndex, &job, &stolen))
+        return false;
+
+    if (job.dependency && !job.dependency->isDone())
+    {
+        // Not ready, put it behind whatever else is queued here.
+        pushJob(std::move(job), true);
+        return false;
+    }
+
+    job.function();
+
+    JobQueue& queue = *s_queues[s_threadIndex];
+    queue.executed.fetch_add(1, std::memory_order_relaxed);
+    if (stolen)
+        queue.stolen.fetch_add(1, std::memory_order_relaxed);
+
+    if (job.counter)
+        job.counter->value.fetch_sub(1, std::memory_order_acq_rel);
+
+    return true;
+}
+
+static void workerLoop(u32 threadIndex)
+{
+    s_threadIndex = threadIndex;
+
+    while (s_running.load(std::memory_order_acquire))
+    {
+        if (runOneJob())
+            continue;
+
+        if (s_queuedJobs.load(std::memory_order_acquire) > 0)
+        {
+            // Only blocked jobs left (or lost a race for one).
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(s_sleepMutex);
+        s_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        s_wakeCondition.wait(lock, [] {
+            return s_queuedJobs.load(std::memory_order_seq_cst) > 0 || !s_running.load(std::memory_order_acquire);
+        });
+        s_sleepingWorkers.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void Velox::initJobSystem(i32 workerCount)
+{
+    if (s_running)
+    {
+        LOG_WARN("Job system is already initialised");
+        return;
+    }
+
+    if (workerCount < 0)
+    {
+        i32 hardwareThreads = static_cast<i32>(std::thread::hardware_concurrency());
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    s_threadIndex = 0;
+    s_queuedJobs = 0;
+    s_running = true;
+
+    s_queues.clear();
+    for (i32 i = 0; i < workerCount + 1; i++)
+        s_queues.push_back(std::make_unique<JobQueue>());
+
+    s_workers.reserve(workerCount);
+    for (u32 i = 1; i <= static_cast<u32>(workerCount); i++)
+        s_workers.emplace_back(workerLoop, i);
+
+    LOG_INFO("Job system started with {} worker threads", workerCount);
+}
+
+void Velox::deInitJobSystem()
+{
+    if (!s_running)
+        return;
+
+    while (s_queuedJobs.load(std::memory_order_acquire) > 0)
+    {
+        if (!runOneJob())
+            std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_sleepMutex);
+        s_running = false;
+    }
+    s_wakeCondition.notify_all();
+
+    for (std::thread& worker : s_workers)
+        worker.join();
+
+    s_workers.clear();
+    s_queues.clear();
+}
+
+u32 Velox::getJobThreadCount()
+{
+    return s_queues.empty() ? 1 : static_cast<u32>(s_queues.size());
+}
+
+u32 Velox::getJobThreadIndex()
+{
+    return s_threadIndex;
+}
+
+void Velox::runJob(std::function<void()> job, Velox::JobCounter* counter)
+{
+    Velox::runJobAfter(nullptr, std::move(job), counter);
+}
+
+void Velox::runJobAfter(Velox::JobCounter* dependency, std::function<void()> job, Velox::JobCounter* counter)
+{
+    if (!s_running)
+    {
+        // No pool, nothing else can make progress on dependency either.
+        job();
+        return;
+    }
+
+    if (counter)
+        counter->value.fetch_add(1, std::memory_order_acq_rel);
+
+    pushJob({ std::move(job), counter, dependency });
+}
+
+void Velox::waitForCounter(Velox::JobCounter* counter)
+{
+    while (!counter->isDone())
+    {
+        if (!runOneJob())
+            std::this_thread::yield();
+    }
+}
+
+void Velox::parallelFor(u32 begin, u32 end, u32 batchSize, const std::function<void(u32, u32)>& function)
+{
+    if (begin >= end)
+        return;
+
+    if (batchSize == 0)
+        batchSize = 1;
+
+    if (!s_running || s_workers.empty() || end - begin <= batchSize)
+    {
+        function(begin, end);
+        return;
+    }
+
+    Velox::JobCounter counter;
+    for (u32 batchBegin = begin; batchBegin < end; batchBegin += batchSize)
+    {
+        u32 batchEnd = batchSize < end - batchBegin ? batchBegin + batchSize : end;
+        Velox::runJob([&function, batchBegin, batchEnd] { function(batchBegin, batchEnd); }, &counter);
+    }
+
+    Velox::waitForCounter(&counter);
+}
+
+Velox::JobStats Velox::getJobStats(u32 threadIndex)
+{
+    if (threadIndex >= s_queues.size())
+        return {};
+
+    return {
+        s_queues[threadIndex]->executed.load(std::memory_order_relaxed),
+        s_queues[threadIndex]->stolen.load(std::memory_order_relaxed),
+    };
+}
+
+void Velox::resetJobStats()
+{
+    for (auto& queue : s_queues)
+    {
+        queue->executed = 0;
+        queue->stolen   = 0;
+    }
+}
@@ -12,7 +12,8 @@ void Velox::initLog()
 {
     std::string logFileOutput = fmt::format("{}logs/logs.txt", SDL_GetBasePath());
 
-    auto consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+    // Job workers log too, so both sinks lock.
+    auto consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
     consoleSink->set_level(spdlog::level::trace);
     consoleSink->set_pattern("[%^%l%$] %v");
 
@@ -0,0 +1,7 @@
+#include "Rendering/GLState.h"
+#include <PCH.h>
+
+// One per thread, each thread drawing has a GL context of its own.
+static thread_local Velox::GLStateCache s_glState;
+
+Velox::GLStateCache* Velox::getGLState() { return &s_glState; }
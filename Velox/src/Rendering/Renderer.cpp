@@ -4,9 +4,11 @@
 #include "Asset.h"
 #include "Config.h"
 #include "Event.h"
+#include "Rendering/GLState.h"
 #include "Rendering/Pipeline.h"
 #include "Text.h"
 #include "Core.h"
+#include "Util.h"
 
 #include <glad/gl.h> // Must be included before SDL
 
@@ -18,15 +20,26 @@
 #include <SDL3/SDL_opengl.h>
 #include <SDL3_image/SDL_image.h>
 
+#include <glm/gtc/packing.hpp>
+
 #include <imgui.h>
 #include <imgui_impl_sdl3.h>
 #include <imgui_impl_opengl3.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 // Aparently windows uses this as 'default' scale.
 constexpr float USER_DEFAULT_SCREEN_DPI = 96.0f;
 
 constexpr u32 MAX_TEXTURES = 512;
 
+// Texture units a texture group can use, also the size of the sampler array in textured_quad.frag.glsl.
+constexpr u32 MAX_TEXTURE_SLOTS = 16;
+
 constexpr char DEFAULT_SHADER_NAME[] = "default_shader";
 
 constexpr u32  QUAD_VERTEX_INDICES[6]   = { 0, 1, 2, 2, 3, 0 };
@@ -69,20 +82,196 @@ void*       Velox::GetGLContext() { return &g_glContext; }
 bool g_frameBufferResized = false;
 
 u32 g_uniformBufferObject;
+u32 g_quadIndexBuffer;
 
 Velox::TexturedQuadPipeline g_texturedQuadPipeline;
 Velox::LinePipeline         g_linePipeline;
 Velox::FontPipeline         g_fontPipeline;
+Velox::SpritePipeline       g_spritePipeline;
 
+// Screen space, over the whole window.
 mat4 g_projection;
-mat4 g_view;
+static vec2 s_projectionSize;
+
+static Velox::Camera s_cameras[Velox::MAX_CAMERAS];
+static bool s_cameraUsed[Velox::MAX_CAMERAS] = { true }; // 0 is the main camera.
+
+// Uniform buffer slot of each layer, 0 is screen space and camera i is slot i + 1.
+static u8 s_layerCameraSlots[256];
+static u32 s_uniformSlotStride = sizeof(Velox::UniformBufferObject);
+
+// What submitting needs of the cameras, taken on the main thread so the render thread never
+// reads them while they're being changed.
+struct FrameView {
+    Velox::UniformBufferObject uniforms[Velox::MAX_CAMERAS + 1]; // Per uniform buffer slot.
+    i32 viewports[Velox::MAX_CAMERAS + 1][4];                     // In pixels, bottom left origin.
+    u8  layerCameraSlots[256];
+};
+
+// Of the frame being submitted.
+static FrameView s_submitView;
+static ImDrawData* s_submitImGuiDrawData = nullptr;
+// With a render thread ImGui comes drawn already, see renderImGuiToPacket(). 0 for nothing to draw.
+static u32   s_submitImGuiTexture = 0;
+static ivec2 s_submitImGuiSize    = ivec2(0);
 
 u32 g_drawCommandCount = 0;
 std::vector<Velox::DrawCommand> g_drawCommands;
 
+static Velox::RenderStats s_renderStats;
+static Velox::RenderStats s_lastRenderStats;
+
+// Frames of timer queries kept, results are read the next time a frame's set comes around so
+// reading them never waits on the GPU.
+constexpr u32 GPU_TIMER_FRAMES = 4;
+
+// GL_TIMESTAMP at the start and end of every pass. Query objects aren't shared between contexts,
+// so these belong to whichever thread submits.
+struct GpuTimerFrame {
+    u32  queries[Velox::RenderPass_COUNT * 2] = {};
+    bool issued = false;
+};
+
+static GpuTimerFrame s_gpuTimerFrames[GPU_TIMER_FRAMES];
+static u32 s_gpuTimerFrame = 0;
+static f32 s_gpuPassMs[Velox::RenderPass_COUNT] = {};
+static f32 s_gpuFrameMs = 0.0f;
+static u64 s_cpuPassStart = 0;
+
+// Per thread so draw lists can be recorded with their own layers.
+static thread_local u8 s_drawLayer = Velox::DRAW_LAYER_DEFAULT;
+static bool s_orderedDrawLayers[256] = {};
+
+static std::vector<Velox::SortItem> s_sortItems;
+static std::vector<Velox::SortItem> s_sortScratch;
+
+// Textures bound together for one batch, slot i goes to texture unit i.
+struct TextureGroup {
+    u32 textures[MAX_TEXTURE_SLOTS];
+    u32 count = 0;
+};
+
+// Filled in draw order, cleared whenever the draw commands are submitted.
+static std::vector<TextureGroup> s_textureGroups(1);
+static u32 s_textureSlotCount = MAX_TEXTURE_SLOTS;
+
+// Quads sharing state in a static batch, laid out next to each other.
+struct StaticBatchDraw {
+    Velox::Pipeline*      pipeline;
+    Velox::ShaderProgram* shader;
+    Velox::Texture*       texture;
+    u32 textureGroup;
+    u64 sortKey;
+    u32 firstVertex;
+    u32 quadCount;
+};
+
+// Draws kept in memory of their own instead of the pipelines, for static batches and draw lists.
+// Whatever depends on the rest of the frame is filled in when they are replayed: texture slots
+// (and the texture part of sort keys) aren't assigned yet, font vertex styles index fontStyles.
+struct DrawRecording {
+    std::vector<Velox::TextureVertex>  quadVertices;
+    std::vector<Velox::LineVertex>     lineVertices;
+    std::vector<Velox::FontVertex>     fontVertices;
+    std::vector<Velox::SpriteInstance> sprites;
+    std::vector<Velox::FontStyle>      fontStyles;
+    std::vector<mat4>                  staticTransforms;
+    // In draw order, vertexOffset is into the vertices of the command's pipeline.
+    std::vector<Velox::DrawCommand>    commands;
+
+    // Static batches only keep default shader quads and text, everything else is drawn right away.
+    bool retained = false;
+
+    void clear()
+    {
+        quadVertices.clear();
+        lineVertices.clear();
+        fontVertices.clear();
+        sprites.clear();
+        fontStyles.clear();
+        staticTransforms.clear();
+        commands.clear();
+    }
+};
+
+// What this thread's draws go into, nullptr for the frame itself.
+static thread_local DrawRecording* s_recording = nullptr;
+
+struct Velox::DrawList {
+    std::string name;
+    DrawRecording recording;
+    // Of the recording thread, put back by endDrawList().
+    u8 savedDrawLayer = Velox::DRAW_LAYER_DEFAULT;
+};
+
+static thread_local Velox::DrawList* s_recordingList = nullptr;
+
+struct Velox::StaticBatch {
+    std::string name;
+
+    DrawRecording recording;
+    std::vector<TextureGroup> textureGroups;
+
+    // Once recorded.
+    std::vector<StaticBatchDraw> draws;
+    u32 quadVertexBuffer = 0;
+    u32 fontVertexBuffer = 0;
+    u32 fontStyleBuffer  = 0;
+    u32 quadVao = 0;
+    u32 fontVao = 0;
+};
+
+static Velox::StaticBatch* s_recordingBatch = nullptr;
+// Transforms of this frame's drawStaticBatch() calls, indexed by DrawCommand::staticTransform.
+static std::vector<mat4> s_staticTransforms;
+
+// A finished frame handed to the render thread. Recycled once it has been drawn.
+struct FramePacket {
+    DrawRecording recording;
+    FrameView view;
+    // ImGui's backend and context are main thread only, so it's drawn into this by the main thread
+    // and the render thread only composites it. The framebuffer is the main thread's context's.
+    u32   imguiTexture     = 0;
+    u32   imguiFramebuffer = 0;
+    ivec2 imguiSize        = ivec2(0);
+    bool  imguiDrawn       = false;
+    // Makes what the main thread's context uploaded during the frame visible to the render thread.
+    GLsync resourceFence = nullptr;
+    i32 vsyncMode = 0;
+};
+
+// With Config::renderThread the render thread owns g_glContext, the main thread records whole frames
+// into packets and keeps a context sharing objects with it for loading textures, shaders and static
+// batches. VAOs aren't shared, those are only made and deleted on the render thread.
+static bool s_renderThreadRunning = false;
+static bool s_stopRenderThread = false;
+static std::thread s_renderThread;
+static SDL_GLContext s_resourceContext = nullptr;
+
+static std::mutex s_packetMutex;
+static std::condition_variable s_packetCondition;
+static std::vector<std::unique_ptr<FramePacket>> s_framePackets;
+static std::deque<FramePacket*>  s_queuedPackets;
+static std::vector<FramePacket*> s_freePackets;
+static u32 s_packetsInFlight = 0; // Queued or being drawn.
+static Velox::RenderStats s_renderThreadStats; // Of the last packet drawn.
+static std::vector<u32> s_deadVertexArrays;    // Deleted by the render thread before its next packet.
+
+// Being recorded by the main thread, s_frameRecording is its recording.
+static FramePacket* s_recordingPacket = nullptr;
+static thread_local DrawRecording* s_frameRecording = nullptr;
+
+// Where this thread's draws go, nullptr to write them into the pipelines.
+static DrawRecording* getRecording() { return s_recording != nullptr ? s_recording : s_frameRecording; }
+
+// Location of u_model in textured_quad.vert.glsl and sdf_quad.vert.glsl, identity outside static batches.
+constexpr i32 MODEL_UNIFORM_LOCATION = 0;
+
 Velox::ShaderProgram* g_defaultShaderProgram;
 Velox::ShaderProgram* g_fontShaderProgram;
 Velox::ShaderProgram* g_colorShaderProgram;
+Velox::ShaderProgram* g_spriteShaderProgram;
+static Velox::ShaderProgram* s_compositeShaderProgram;
 
 Velox::Texture* g_errorTexture;
 Velox::Texture* g_whiteTexture;
@@ -96,8 +285,8 @@ void checkGLError()
         LOG_ERROR("OpenGL Error: err", err);
 }
 
-void Velox::ShaderProgram::use() { glUseProgram(id); }
-void Velox::Texture::use() { glBindTexture(GL_TEXTURE_2D, id); }
+void Velox::ShaderProgram::use() { Velox::getGLState()->useProgram(id); }
+void Velox::Texture::use() { Velox::getGLState()->bindTexture(0, id); }
 
 ivec2 Velox::getWindowSize() { return s_windowSize; }
 i32 Velox::getVsyncMode()    { return s_vsyncMode;  }
@@ -131,10 +320,134 @@ void Velox::setResolution(ivec2 newResolution)
 
     SDL_GetWindowSizeInPixels(g_window, &s_frameBufferSize.x, &s_frameBufferSize.y);
 
-    // update OpenGL things.
-    glViewport(0, 0, s_frameBufferSize.x, s_frameBufferSize.y);
+    // update OpenGL things. The render thread picks the new size up with its next frame.
+    if (!s_renderThreadRunning)
+        glViewport(0, 0, s_frameBufferSize.x, s_frameBufferSize.y);
 
     g_projection =  glm::ortho(0.0f, (float)s_frameBufferSize.x, (float)s_frameBufferSize.y, 0.0f, -1.0f, 1.0f);
+    s_projectionSize = vec2(s_frameBufferSize);
+}
+
+Velox::Camera* Velox::getMainCamera() { return &s_cameras[0]; }
+
+Velox::Camera* Velox::createCamera()
+{
+    for (u32 i = 1; i < Velox::MAX_CAMERAS; i++)
+    {
+        if (s_cameraUsed[i])
+            continue;
+
+        s_cameraUsed[i] = true;
+        s_cameras[i] = Velox::Camera {};
+
+        return &s_cameras[i];
+    }
+
+    LOG_WARN("Out of cameras, there can be at most {}", Velox::MAX_CAMERAS);
+    return nullptr;
+}
+
+void Velox::destroyCamera(Velox::Camera* camera)
+{
+    if (camera == nullptr)
+        return;
+
+    // Below the array wraps around to a huge index too.
+    const u32 index = static_cast<u32>(camera - s_cameras);
+    if (index >= Velox::MAX_CAMERAS)
+    {
+        LOG_WARN("Tried to destroy a camera that wasn't created by the renderer");
+        return;
+    }
+
+    if (index == 0)
+    {
+        LOG_WARN("The main camera can't be destroyed");
+        return;
+    }
+
+    s_cameraUsed[index] = false;
+
+    for (u8& slot : s_layerCameraSlots)
+    {
+        if (slot == index + 1)
+            slot = 1;
+    }
+}
+
+void Velox::setDrawLayerCamera(u8 layer, Velox::Camera* camera)
+{
+    s_layerCameraSlots[layer] = camera != nullptr ? static_cast<u8>(camera - s_cameras) + 1 : 0;
+}
+
+Velox::Camera* Velox::getDrawLayerCamera(u8 layer)
+{
+    const u8 slot = s_layerCameraSlots[layer];
+    return slot != 0 ? &s_cameras[slot - 1] : nullptr;
+}
+
+// Size of the camera's viewport in window coordinates.
+static vec2 getViewportSize(const Velox::Camera* camera)
+{
+    if (camera == nullptr)
+        return s_projectionSize;
+
+    return s_projectionSize * vec2(camera->viewport.w, camera->viewport.h);
+}
+
+static mat4 getCameraProjection(const Velox::Camera* camera)
+{
+    const vec2 size = getViewportSize(camera);
+    return glm::ortho(0.0f, size.x, size.y, 0.0f, -1.0f, 1.0f);
+}
+
+mat4 Velox::getCameraView(const Velox::Camera* camera)
+{
+    if (camera == nullptr)
+        return mat4(1.0f);
+
+    const vec2 center = getViewportSize(camera) * 0.5f;
+
+    return glm::translate(mat4(1.0f), vec3(center, 0.0f)) *
+        glm::rotate(mat4(1.0f), glm::radians(-camera->rotation), vec3(0.0f, 0.0f, 1.0f)) *
+        glm::scale(mat4(1.0f), vec3(camera->zoom, camera->zoom, 1.0f)) *
+        glm::translate(mat4(1.0f), vec3(-camera->position - center, 0.0f));
+}
+
+vec2 Velox::screenToWorld(const vec2& screenPosition, const Velox::Camera* camera)
+{
+    if (camera == nullptr)
+        return screenPosition;
+
+    const vec2 viewportPosition = screenPosition - s_projectionSize * vec2(camera->viewport.x, camera->viewport.y);
+    return vec2(glm::inverse(Velox::getCameraView(camera)) * vec4(viewportPosition, 0.0f, 1.0f));
+}
+
+vec2 Velox::worldToScreen(const vec2& worldPosition, const Velox::Camera* camera)
+{
+    if (camera == nullptr)
+        return worldPosition;
+
+    const vec2 viewportPosition = vec2(Velox::getCameraView(camera) * vec4(worldPosition, 0.0f, 1.0f));
+    return viewportPosition + s_projectionSize * vec2(camera->viewport.x, camera->viewport.y);
+}
+
+Velox::Rectangle Velox::getViewBounds(const Velox::Camera* camera)
+{
+    const mat4 inverse = glm::inverse(getCameraProjection(camera) * Velox::getCameraView(camera));
+
+    vec2 min(std::numeric_limits<f32>::max());
+    vec2 max(std::numeric_limits<f32>::lowest());
+
+    // Corners of clip space, the view can be rotated.
+    for (const vec2 corner : { vec2(-1.0f, -1.0f), vec2(1.0f, -1.0f), vec2(1.0f, 1.0f), vec2(-1.0f, 1.0f) })
+    {
+        const vec4 world = inverse * vec4(corner, 0.0f, 1.0f);
+        min = glm::min(min, vec2(world) / world.w);
+        max = glm::max(max, vec2(world) / world.w);
+    }
+
+    return Velox::Rectangle { min.x, min.y, max.x - min.x, max.y - min.y };
 }
 
 void Velox::setVsyncMode(int newMode)
@@ -149,13 +462,95 @@ void Velox::setVsyncMode(int newMode)
 
     s_config->vsyncMode = s_vsyncMode; 
 
-    // Prevent being called pre-SDL_GL_CreateContext().
-    if (g_glContext != nullptr)
+    // Prevent being called pre-SDL_GL_CreateContext(). The render thread sets it with its next frame.
+    if (g_glContext != nullptr && !s_renderThreadRunning)
         SDL_GL_SetSwapInterval(s_vsyncMode);
 }
 
 bool Velox::isAdaptiveVsyncSupported() { return s_adaptiveVsyncSupported; }
 
+const Velox::RenderStats& Velox::getRenderStats() { return s_lastRenderStats; }
+
+const char* Velox::getRenderPassName(Velox::RenderPass pass)
+{
+    switch (pass)
+    {
+        case Velox::RenderPass_Copy:  return "Copy Pass";
+        case Velox::RenderPass_Draw:  return "Velox render Pass";
+        case Velox::RenderPass_ImGui: return "ImGui";
+        default:                      return "Unknown";
+    }
+}
+
+void Velox::setDrawLayer(u8 layer) { s_drawLayer = layer; }
+u8   Velox::getDrawLayer()         { return s_drawLayer; }
+
+void Velox::setDrawLayerOrdered(u8 layer, bool ordered) { s_orderedDrawLayers[layer] = ordered; }
+
+// Bits from the top: layer 8, depth 16, pipeline 8, shader 12, texture 20. Ids that don't fit
+// just share a bucket with another one, that only costs batching.
+//
+// textureKey is the texture group for grouped draws, the texture id otherwise.
+static u64 makeSortKey(const Velox::Pipeline* pipeline, const Velox::ShaderProgram* shader,
+        u32 textureKey, f32 depth)
+{
+    u64 key = static_cast<u64>(s_drawLayer) << 56;
+
+    if (s_orderedDrawLayers[s_drawLayer])
+        return key;
+
+    // Same [-1, 1] range as the projection.
+    const f32 normalisedDepth = (glm::clamp(depth, -1.0f, 1.0f) + 1.0f) * 0.5f;
+
+    key |= static_cast<u64>(normalisedDepth * 65535.0f) << 40;
+    key |= static_cast<u64>(pipeline->id & 0xFF)        << 32;
+    key |= static_cast<u64>(shader->id   & 0xFFF)       << 20;
+    key |= static_cast<u64>(textureKey   & 0xFFFFF);
+
+    return key;
+}
+
+// Default shader quads and sprites sample through texture groups.
+static bool usesTextureGroup(const Velox::DrawCommand& command)
+{
+    return command.pipeline == &g_spritePipeline
+        || (command.pipeline == &g_texturedQuadPipeline && command.shader == g_defaultShaderProgram);
+}
+
+// Recorded sort keys are made with the texture id, swaps in the group once it's known.
+static u64 withTextureGroup(u64 sortKey, u32 group)
+{
+    if (s_orderedDrawLayers[sortKey >> 56])
+        return sortKey;
+
+    return (sortKey & ~0xFFFFFull) | static_cast<u64>(group & 0xFFFFF);
+}
+
+// Indices for MAX_QUADS quads laid out one after another, the same for every frame.
+static u32 createQuadIndexBuffer()
+{
+    std::vector<u32> indices(MAX_INDICES);
+    for (u32 quad = 0; quad < MAX_QUADS; quad++)
+    {
+        for (u32 i = 0; i < 6; i++)
+            indices[quad * 6 + i] = QUAD_VERTEX_INDICES[i] + quad * 4;
+    }
+
+    u32 id;
+    glCreateBuffers(1, &id);
+    glNamedBufferStorage(id, sizeof(u32) * MAX_INDICES, indices.data(), 0);
+    glObjectLabel(GL_BUFFER, id, -1, "Quad Index Buffer");
+
+    return id;
+}
+
+// Defined further down, with the passes and the render thread.
+static void presentFrame();
+static void startRenderThread();
+static void stopRenderThread();
+static void queueFramePacket();
+static void compositeImGui();
+
 void Velox::initRenderer()
 {
     // Support checks
@@ -196,260 +591,1496 @@ void Velox::initRenderer()
     g_glContext = SDL_GL_CreateContext(g_window);
     if (g_window == nullptr)
     {
-        LOG_CRITICAL("Failed to create GL context: {}", SDL_GetError());
-        throw std::runtime_error("");
+        LOG_CRITICAL("Failed to create GL context: {}", SDL_GetError());
+        throw std::runtime_error("");
+    }
+
+    SDL_GL_MakeCurrent(g_window, g_glContext);
+
+    setVsyncMode(s_vsyncMode);
+
+    SDL_SetWindowPosition(g_window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+    SDL_ShowWindow(g_window);
+
+    int version = gladLoadGL((GLADloadfunc) SDL_GL_GetProcAddress);
+    LOG_TRACE("Using GL Version {}", (const char*)glGetString(GL_VERSION));
+    LOG_TRACE("GLAD loaded fns for version {}.{}", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+    SDL_GetWindowSizeInPixels(g_window, &s_frameBufferSize.x, &s_frameBufferSize.y);
+    glViewport(0, 0, s_frameBufferSize.x, s_frameBufferSize.y);
+
+    // Render settings, set again at the start of every submission.
+    Velox::getGLState()->setBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    i32 textureUnits = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+    s_textureSlotCount = glm::clamp(static_cast<u32>(textureUnits), 1u, MAX_TEXTURE_SLOTS);
+    LOG_TRACE("Batching up to {} textures per draw ({} units)", s_textureSlotCount, textureUnits);
+
+    // glEnable(GL_CULL_FACE); 
+    // glCullFace(GL_BACK);
+    // glFrontFace(GL_CW); // Vertices are defind clockwise. This is standard in mordern model formats.
+
+    g_quadIndexBuffer = createQuadIndexBuffer();
+
+    // Ids also order draws at the same depth (see makeSortKey()), so text and lines end up on top of
+    // quads and sprites.
+    g_texturedQuadPipeline.init(1, g_quadIndexBuffer);
+    g_spritePipeline.init(2);
+    g_linePipeline.init(3);
+    g_fontPipeline.init(4, g_quadIndexBuffer);
+
+    // Uniform buffer, one slot for screen space and one per camera. Bound per slot while submitting.
+    i32 uniformOffsetAlignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformOffsetAlignment);
+    s_uniformSlotStride = (sizeof(Velox::UniformBufferObject) + uniformOffsetAlignment - 1) / uniformOffsetAlignment * uniformOffsetAlignment;
+
+    glGenBuffers(1, &g_uniformBufferObject);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_uniformBufferObject);
+
+    glBufferData(GL_UNIFORM_BUFFER, s_uniformSlotStride * (Velox::MAX_CAMERAS + 1), nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, g_uniformBufferObject, 0, sizeof(Velox::UniformBufferObject));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glObjectLabel(GL_BUFFER, g_uniformBufferObject, -1, "Uniform Buffer");
+
+    for (u32 layer = 0; layer < 256; layer++)
+        s_layerCameraSlots[layer] = layer < Velox::DRAW_LAYER_UI ? 1 : 0;
+
+    // Load default assets
+    Velox::AssetManager* assetManager = Velox::getAssetManager();
+
+    g_defaultShaderProgram = assetManager->loadShaderProgram(
+        "shaders\\textured_quad.vert.glsl",
+        "shaders\\textured_quad.frag.glsl",
+        DEFAULT_SHADER_NAME);
+
+    g_fontShaderProgram = assetManager->loadShaderProgram(
+        "shaders\\sdf_quad.vert.glsl",
+        "shaders\\sdf_quad.frag.glsl",
+        "sdf_quad");
+
+    g_colorShaderProgram = assetManager->loadShaderProgram(
+        "shaders\\colored.vert.glsl",
+        "shaders\\colored.frag.glsl",
+        "color");
+
+    g_spriteShaderProgram = assetManager->loadShaderProgram(
+        "shaders\\sprite.vert.glsl",
+        "shaders\\textured_quad.frag.glsl",
+        "sprite");
+
+    s_compositeShaderProgram = assetManager->loadShaderProgram(
+        "shaders\\composite.vert.glsl",
+        "shaders\\composite.frag.glsl",
+        "composite");
+
+    g_errorTexture = assetManager->loadTexture("missing_texture.png");
+    g_whiteTexture = assetManager->loadTexture("white.png");
+
+    g_projection =  glm::ortho(0.0f, (float)s_windowSize.x, (float)s_windowSize.y, 0.0f, -1.0f, 1.0f);
+    s_projectionSize = vec2(s_windowSize);
+    
+    Velox::SubscribeInfo subInfo {
+        .name = "Renderer",
+        .eventRangeStart = SDL_EVENT_DISPLAY_FIRST,
+        .eventRangeEnd   = SDL_EVENT_WINDOW_LAST,  // Window events are just after display events.
+        .callback = Velox::rendererEventCallback,
+        .priority = 2,
+    };
+
+    Velox::getEventPublisher()->subscribe(subInfo);
+
+    // Draws can be flushed at any point in the frame, so the frame is cleared up front.
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    checkGLError();
+
+    if (s_config->renderThread)
+        startRenderThread();
+}
+
+bool Velox::rendererEventCallback(SDL_Event& event)
+{
+    return false;
+}
+
+void Velox::drawFrame()
+{
+
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+void Velox::submitFrameData()
+{
+    // GM: For now we just insert engine stuff here.
+    // Mosly just drawing engine UI elements.
+    Velox::doFrameEndUpdates();
+
+    // Generate ImGui stuff.
+    ImGui::Render();
+
+    if (s_renderThreadRunning)
+    {
+        // Stats come back from the render thread, framesInFlight frames late.
+        queueFramePacket();
+    }
+    else
+    {
+        s_submitImGuiDrawData = ImGui::GetDrawData();
+        presentFrame();
+
+        s_lastRenderStats = s_renderStats;
+        s_renderStats = {};
+    }
+
+    // Reset render frame state.
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplSDL3_NewFrame();
+    ImGui::NewFrame();
+
+    s_drawLayer = Velox::DRAW_LAYER_DEFAULT;
+}
+
+static void captureFrameView(FrameView* view)
+{
+    ivec2 resolution;
+    SDL_GetWindowSize(g_window, &resolution.x, &resolution.y);
+
+    const vec2 frameBufferSize = vec2(s_frameBufferSize);
+
+    for (u32 slot = 0; slot < Velox::MAX_CAMERAS + 1; slot++)
+    {
+        view->uniforms[slot] = {};
+
+        i32* viewport = view->viewports[slot];
+        viewport[0] = 0;
+        viewport[1] = 0;
+        viewport[2] = s_frameBufferSize.x;
+        viewport[3] = s_frameBufferSize.y;
+
+        if (slot != 0 && !s_cameraUsed[slot - 1])
+            continue;
+
+        const Velox::Camera* camera = slot != 0 ? &s_cameras[slot - 1] : nullptr;
+
+        Velox::UniformBufferObject& ubo = view->uniforms[slot];
+        ubo.projection = slot != 0 ? getCameraProjection(camera) : g_projection;
+        ubo.view       = Velox::getCameraView(camera);
+        ubo.resolution = resolution;
+
+        if (camera == nullptr)
+            continue;
+
+        // GL viewports start at the bottom left.
+        const Velox::Rectangle& rect = camera->viewport;
+        viewport[0] = static_cast<i32>(rect.x * frameBufferSize.x);
+        viewport[1] = static_cast<i32>((1.0f - rect.y - rect.h) * frameBufferSize.y);
+        viewport[2] = static_cast<i32>(rect.w * frameBufferSize.x);
+        viewport[3] = static_cast<i32>(rect.h * frameBufferSize.y);
+    }
+
+    SDL_memcpy(view->layerCameraSlots, s_layerCameraSlots, sizeof(s_layerCameraSlots));
+}
+
+static void uploadUniforms()
+{
+    // The render thread has the view its packet was recorded with.
+    if (!s_renderThreadRunning)
+        captureFrameView(&s_submitView);
+
+    static std::vector<u8> s_uniformData;
+    s_uniformData.assign(s_uniformSlotStride * (Velox::MAX_CAMERAS + 1), 0);
+
+    for (u32 slot = 0; slot < Velox::MAX_CAMERAS + 1; slot++)
+        SDL_memcpy(&s_uniformData[slot * s_uniformSlotStride], &s_submitView.uniforms[slot], sizeof(Velox::UniformBufferObject));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_uniformBufferObject);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, s_uniformData.size(), s_uniformData.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Uniform buffer slot and viewport of a camera, see s_layerCameraSlots.
+static void bindCameraSlot(u8 slot)
+{
+    Velox::GLStateCache* state = Velox::getGLState();
+
+    state->bindBufferRange(GL_UNIFORM_BUFFER, 0, g_uniformBufferObject, slot * s_uniformSlotStride, sizeof(Velox::UniformBufferObject));
+
+    const i32* viewport = s_submitView.viewports[slot];
+    state->setViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// Reads the results of the oldest set of timer queries, the set the coming frame reuses. If the
+// GPU is more than GPU_TIMER_FRAMES behind they're dropped and the last results stay.
+static void readGpuTimers()
+{
+    GpuTimerFrame& frame = s_gpuTimerFrames[s_gpuTimerFrame];
+
+    if (frame.queries[0] == 0)
+        glGenQueries(Velox::RenderPass_COUNT * 2, frame.queries);
+
+    if (!frame.issued)
+        return;
+
+    frame.issued = false;
+
+    i32 available = 0;
+    glGetQueryObjectiv(frame.queries[Velox::RenderPass_COUNT * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    u64 timestamps[Velox::RenderPass_COUNT * 2];
+    for (u32 i = 0; i < Velox::RenderPass_COUNT * 2; i++)
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+    // Nanoseconds.
+    for (u32 pass = 0; pass < Velox::RenderPass_COUNT; pass++)
+        s_gpuPassMs[pass] = static_cast<f32>(timestamps[pass * 2 + 1] - timestamps[pass * 2]) / 1e6f;
+
+    s_gpuFrameMs = static_cast<f32>(timestamps[Velox::RenderPass_COUNT * 2 - 1] - timestamps[0]) / 1e6f;
+}
+
+// Pushes the pass' debug group and starts timing it.
+static void beginRenderPass(Velox::RenderPass pass)
+{
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, Velox::getRenderPassName(pass));
+    glQueryCounter(s_gpuTimerFrames[s_gpuTimerFrame].queries[pass * 2], GL_TIMESTAMP);
+
+    s_cpuPassStart = SDL_GetPerformanceCounter();
+}
+
+static void endRenderPass(Velox::RenderPass pass)
+{
+    const u64 cpuTicks = SDL_GetPerformanceCounter() - s_cpuPassStart;
+    s_renderStats.cpuPassMs[pass] = static_cast<f32>(cpuTicks * MS_PER_SECOND) / SDL_GetPerformanceFrequency();
+
+    glQueryCounter(s_gpuTimerFrames[s_gpuTimerFrame].queries[pass * 2 + 1], GL_TIMESTAMP);
+    glPopDebugGroup();
+}
+
+void Velox::doCopyPass()
+{
+    beginRenderPass(Velox::RenderPass_Copy);
+
+    // Vertex data is written straight into mapped buffers by the draw calls, see StreamBuffer.
+
+    uploadUniforms();
+
+    endRenderPass(Velox::RenderPass_Copy);
+}
+
+// Returns the slot of texture in the last of groups, adding it if it isn't there yet.
+// Starts a new group once that one is full, *group is set to the group used.
+static u32 getTextureSlot(std::vector<TextureGroup>* groups, const Velox::Texture* texture, u32* group)
+{
+    TextureGroup* current = &groups->back();
+
+    for (u32 i = 0; i < current->count; i++)
+    {
+        if (current->textures[i] == texture->id)
+        {
+            *group = static_cast<u32>(groups->size()) - 1;
+            return i;
+        }
+    }
+
+    if (current->count >= s_textureSlotCount)
+    {
+        groups->emplace_back();
+        current = &groups->back();
+    }
+
+    current->textures[current->count] = texture->id;
+    *group = static_cast<u32>(groups->size()) - 1;
+
+    return current->count++;
+}
+
+static void bindTextureGroup(const TextureGroup& group)
+{
+    // Units already holding the same texture are skipped by the state cache.
+    for (u32 i = 0; i < group.count; i++)
+        Velox::getGLState()->bindTexture(i, group.textures[i] > 0 ? group.textures[i] : g_errorTexture->id);
+}
+
+// Writes the command's indices after whatever its pipeline already has in the command's segment.
+// Not for quad pipelines, those use the shared quad indices.
+static void writeIndices(Velox::DrawCommand& command)
+{
+    Velox::Pipeline* pipeline = command.pipeline;
+    u32& submittedIndexCount = pipeline->submittedIndexCounts[command.segment];
+
+    u32* indices = pipeline->indices(command.segment) + submittedIndexCount;
+
+    if (pipeline->instanced)
+    {
+        indices[0] = command.vertexOffset;
+    }
+    else
+    {
+        indices[0] = command.vertexOffset + 0;
+        indices[1] = command.vertexOffset + 1;
+    }
+
+    command.indexOffset = submittedIndexCount;
+    submittedIndexCount += command.numIndices;
+}
+
+// Draws of the batch being built. Pipelines writing their own indices draw one range of them,
+// quad pipelines draw runs of quads that sit next to each other in the vertex buffer.
+struct DrawBatch {
+    u32 indexOffset = 0; // Bytes.
+    u32 indexCount  = 0;
+
+    std::vector<GLsizei>     runCounts;
+    std::vector<GLint>       runBaseVertices;
+    std::vector<const void*> runOffsets; // All 0, every run starts at the first quad's indices.
+    u32 runEndVertex = 0;
+};
+
+static DrawBatch s_batch;
+
+static void addToBatch(const Velox::DrawCommand& command)
+{
+    if (command.pipeline->quadIndexBuffer == 0)
+    {
+        s_batch.indexCount += command.numIndices;
+        return;
+    }
+
+    if (s_batch.runCounts.empty() || command.vertexOffset != s_batch.runEndVertex)
+    {
+        s_batch.runCounts.push_back(0);
+        s_batch.runBaseVertices.push_back(command.pipeline->segmentBaseVertex(command.segment) + command.vertexOffset);
+        s_batch.runOffsets.push_back(nullptr);
+    }
+
+    s_batch.runCounts.back() += command.numIndices;
+    s_batch.runEndVertex = command.vertexOffset + 4;
+}
+
+static void drawBatch(Velox::Pipeline* pipeline)
+{
+    if (pipeline->quadIndexBuffer != 0 && !s_batch.runCounts.empty())
+    {
+        pipeline->drawQuadRuns(s_batch.runCounts.data(), s_batch.runOffsets.data(),
+                s_batch.runBaseVertices.data(), static_cast<u32>(s_batch.runCounts.size()));
+        s_renderStats.drawCalls += 1;
+    }
+    else if (pipeline->quadIndexBuffer == 0 && s_batch.indexCount > 0)
+    {
+        pipeline->draw(s_batch.indexOffset, s_batch.indexCount);
+        s_renderStats.drawCalls += 1;
+    }
+
+    s_batch.indexCount = 0;
+    s_batch.runCounts.clear();
+    s_batch.runBaseVertices.clear();
+    s_batch.runOffsets.clear();
+}
+
+template <typename Vertex>
+static u32 createStaticVao(u32 vertexBuffer)
+{
+    if (vertexBuffer == 0)
+        return 0;
+
+    u32 vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    Vertex::setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_quadIndexBuffer);
+
+    glBindVertexArray(0);
+
+    return vao;
+}
+
+// Binds everything but the camera, the caller has to assume nothing it bound is still bound.
+static void drawStaticCommand(const Velox::DrawCommand& command)
+{
+    Velox::StaticBatch& batch = *command.staticBatch;
+    const StaticBatchDraw& draw = batch.draws[command.staticDraw];
+    const bool font = draw.pipeline == &g_fontPipeline;
+
+    // Made by the thread drawing it, VAOs aren't shared between contexts.
+    u32& vao = font ? batch.fontVao : batch.quadVao;
+    if (vao == 0)
+    {
+        vao = font
+            ? createStaticVao<Velox::FontPipeline>(batch.fontVertexBuffer)
+            : createStaticVao<Velox::TexturedQuadPipeline>(batch.quadVertexBuffer);
+
+        // Bound behind the cache's back.
+        Velox::getGLState()->invalidate();
+    }
+
+    Velox::getGLState()->bindVertexArray(vao);
+    if (font)
+        Velox::getGLState()->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, batch.fontStyleBuffer);
+
+    if (draw.shader->id <= 0) g_defaultShaderProgram->use();
+    else                      draw.shader->use();
+
+    if (draw.textureGroup != UINT32_MAX)
+    {
+        const TextureGroup& group = batch.textureGroups[draw.textureGroup];
+        bindTextureGroup(group);
+        s_renderStats.textureChanges += group.count;
+    }
+    else
+    {
+        if (draw.texture->id <= 0) g_errorTexture->use();
+        else                       draw.texture->use();
+        s_renderStats.textureChanges += 1;
+    }
+
+    glUniformMatrix4fv(MODEL_UNIFORM_LOCATION, 1, GL_FALSE, &s_staticTransforms[command.staticTransform][0][0]);
+
+    // The shared quad indices only cover MAX_QUADS.
+    for (u32 first = 0; first < draw.quadCount; first += MAX_QUADS)
+    {
+        const u32 quadCount = std::min(draw.quadCount - first, MAX_QUADS);
+        glDrawElementsBaseVertex(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_INT, nullptr, draw.firstVertex + first * 4);
+        s_renderStats.drawCalls += 1;
+    }
+
+    const mat4 identity(1.0f);
+    glUniformMatrix4fv(MODEL_UNIFORM_LOCATION, 1, GL_FALSE, &identity[0][0]);
+
+    s_renderStats.pipelineChanges += 1;
+    s_renderStats.shaderChanges   += 1;
+}
+
+static void submitDrawCommands()
+{
+    if (g_drawCommands.size() <= 0)
+        return;
+
+    const u32 commandCount = static_cast<u32>(g_drawCommands.size());
+
+    s_sortItems.resize(commandCount);
+    for (u32 i = 0; i < commandCount; i++)
+        s_sortItems[i] = { g_drawCommands[i].sortKey, i };
+
+    Velox::radixSort(&s_sortItems, &s_sortScratch);
+
+    // Whatever ran since the last submission may have bound things behind the cache's back.
+    Velox::GLStateCache* glState = Velox::getGLState();
+    glState->invalidate();
+    glState->setBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    Velox::Pipeline* currentPipeline = nullptr;
+    u32 currentSegment  = UINT32_MAX;
+    u32 currentShaderID = UINT32_MAX;
+    // Texture id, or group index in the high bits for grouped draws.
+    u64 currentTextures = UINT64_MAX;
+    u8  currentCameraSlot = UINT8_MAX;
+    bool anythingBound = false;
+
+    // Indices are written in sorted order, so a batch is always one contiguous range of them.
+    for (const Velox::SortItem& item : s_sortItems)
+    {
+        Velox::DrawCommand& command = g_drawCommands[item.value];
+
+        // Commands are sorted by layer first, so this only changes between layers.
+        const u8 cameraSlot = s_submitView.layerCameraSlots[command.sortKey >> 56];
+        const bool cameraChanged = cameraSlot != currentCameraSlot;
+
+        if (command.staticBatch != nullptr)
+        {
+            if (currentPipeline != nullptr)
+                drawBatch(currentPipeline);
+
+            if (cameraChanged)
+            {
+                currentCameraSlot = cameraSlot;
+                bindCameraSlot(cameraSlot);
+            }
+
+            drawStaticCommand(command);
+
+            currentPipeline  = nullptr;
+            currentSegment   = UINT32_MAX;
+            currentShaderID  = UINT32_MAX;
+            currentTextures  = UINT64_MAX;
+            anythingBound    = true;
+            continue;
+        }
+
+        if (command.pipeline->quadIndexBuffer == 0)
+            writeIndices(command);
+
+        // Equal keys keep submission order, so a segment change only splits a batch where one filled up.
+        const bool pipelineChanged = command.pipeline    != currentPipeline || command.segment != currentSegment;
+        const bool shaderChanged   = command.shader->id  != currentShaderID;
+
+        const u64 textures = command.textureGroup != UINT32_MAX
+            ? (1ull << 32) | command.textureGroup
+            : command.texture->id;
+        const bool textureChanged  = textures != currentTextures;
+
+        if (pipelineChanged || shaderChanged || textureChanged || cameraChanged)
+        {
+            // Submit batch of draws.
+            if (currentPipeline != nullptr)
+                drawBatch(currentPipeline);
+
+            const bool firstBatch = !anythingBound;
+            anythingBound = true;
+
+            if (cameraChanged)
+            {
+                currentCameraSlot = cameraSlot;
+                bindCameraSlot(cameraSlot);
+            }
+
+            if (pipelineChanged)
+            {
+                currentPipeline = command.pipeline;
+                currentSegment  = command.segment;
+                currentPipeline->use(currentSegment);
+                s_renderStats.pipelineChanges += !firstBatch;
+            }
+
+            if (shaderChanged)
+            {
+                currentShaderID = command.shader->id;
+                if (currentShaderID <= 0) g_defaultShaderProgram->use();
+                else                      command.shader->use();
+                s_renderStats.shaderChanges += !firstBatch;
+            }
+
+            if (textureChanged)
+            {
+                currentTextures = textures;
+
+                if (command.textureGroup != UINT32_MAX)
+                {
+                    const TextureGroup& group = s_textureGroups[command.textureGroup];
+                    bindTextureGroup(group);
+                    s_renderStats.textureChanges += firstBatch ? group.count - 1 : group.count;
+                }
+                else
+                {
+                    if (command.texture->id <= 0) g_errorTexture->use();
+                    else                          command.texture->use();
+                    s_renderStats.textureChanges += !firstBatch;
+                }
+            }
+
+            s_batch.indexOffset = command.indexOffset * sizeof(u32);
+        }
+        
+        addToBatch(command);
+    }
+
+    // Render last batch.
+    if (currentPipeline != nullptr)
+        drawBatch(currentPipeline);
+
+    g_drawCommands.clear();
+    s_staticTransforms.clear();
+
+    s_textureGroups.clear();
+    s_textureGroups.emplace_back();
+
+    const i32* viewport = s_submitView.viewports[0];
+    glState->setViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glState->bindTexture(0, 0);
+    glState->useProgram(0);
+}
+
+// Pipeline is out of room. While it has segments left its draws stay where they are and get sorted
+// with the rest of the frame, after that everything recorded so far is drawn before moving on.
+static void flushPipeline(Velox::Pipeline* pipeline)
+{
+    if (pipeline->canSkipFence())
+    {
+        pipeline->nextSegmentUnfenced();
+        return;
+    }
+
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Mid-frame Flush");
+
+    uploadUniforms();
+    submitDrawCommands();
+
+    glPopDebugGroup();
+
+    pipeline->nextSegment();
+    s_renderStats.flushes += 1;
+}
+
+// Frame draws go into the pipeline segment current when they're written.
+static void pushDrawCommand(Velox::DrawCommand command)
+{
+    command.segment = command.pipeline->segment();
+    g_drawCommands.push_back(command);
+}
+
+// Makes sure pipeline has room for the given counts, flushing if it doesn't.
+static void reserve(Velox::Pipeline* pipeline, u32 vertexCount, u32 indexCount)
+{
+    if (pipeline->vertexCount + vertexCount > MAX_VERTICES || pipeline->indexCount + indexCount > MAX_INDICES)
+        flushPipeline(pipeline);
+}
+
+// Returns the index of style in the font pipeline's current style segment, only writing it if it
+// differs from the last one written.
+static u32 writeFontStyle(const Velox::FontStyle& style)
+{
+    static Velox::FontStyle s_lastStyle {};
+
+    if (g_fontPipeline.drawDataCount > 0 && SDL_memcmp(&s_lastStyle, &style, sizeof(style)) == 0)
+        return g_fontPipeline.drawDataCount - 1;
+
+    if (g_fontPipeline.drawDataCount >= MAX_FONT_STYLES)
+        flushPipeline(&g_fontPipeline);
+
+    g_fontPipeline.styles()[g_fontPipeline.drawDataCount] = style;
+    s_lastStyle = style;
+
+    return g_fontPipeline.drawDataCount++;
+}
+
+void Velox::doRenderPass()
+{
+    beginRenderPass(Velox::RenderPass_Draw);
+    submitDrawCommands();
+    endRenderPass(Velox::RenderPass_Draw);
+
+    beginRenderPass(Velox::RenderPass_ImGui);
+    if (s_submitImGuiTexture != 0)
+        compositeImGui();
+    else if (s_submitImGuiDrawData != nullptr)
+        ImGui_ImplOpenGL3_RenderDrawData(s_submitImGuiDrawData);
+    endRenderPass(Velox::RenderPass_ImGui);
+}
+
+// Draws everything submitted this frame and swaps, then moves each pipeline to its next buffer
+// segment. On whichever thread owns g_glContext.
+static void presentFrame()
+{
+    readGpuTimers();
+
+    // Copy our vertex data to GPU.
+    Velox::doCopyPass();
+
+    // Draw out stuff.
+    Velox::doRenderPass();
+
+    s_gpuTimerFrames[s_gpuTimerFrame].issued = true;
+    s_gpuTimerFrame = (s_gpuTimerFrame + 1) % GPU_TIMER_FRAMES;
+
+    SDL_GL_SwapWindow(g_window);
+
+    g_texturedQuadPipeline.nextSegment();
+    g_linePipeline.nextSegment();
+    g_fontPipeline.nextSegment();
+    g_spritePipeline.nextSegment();
+
+    Velox::GLStateCache* glState = Velox::getGLState();
+    s_renderStats.glCallsIssued  = glState->issued;
+    s_renderStats.glCallsSkipped = glState->skipped;
+    glState->resetStats();
+
+    SDL_memcpy(s_renderStats.gpuPassMs, s_gpuPassMs, sizeof(s_gpuPassMs));
+    s_renderStats.gpuFrameMs = s_gpuFrameMs;
+
+    // Draws can be flushed at any point in the frame, so the next one is cleared up front.
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void Velox::deInitRenderer()
+{
+    stopRenderThread();
+
+    for (GpuTimerFrame& frame : s_gpuTimerFrames)
+        glDeleteQueries(Velox::RenderPass_COUNT * 2, frame.queries);
+
+    g_texturedQuadPipeline.deInit();
+    g_linePipeline.deInit();
+    g_fontPipeline.deInit();
+    g_spritePipeline.deInit();
+
+    glDeleteBuffers(1, &g_uniformBufferObject);
+    glDeleteBuffers(1, &g_quadIndexBuffer);
+
+    glDeleteProgram(g_defaultShaderProgram->id);
+
+    SDL_GL_DestroyContext(g_glContext);
+    SDL_DestroyWindow(g_window);
+    SDL_Quit();
+}
+
+Velox::StaticBatch* Velox::createStaticBatch(const char* name)
+{
+    Velox::StaticBatch* batch = new Velox::StaticBatch();
+    batch->name = name;
+
+    return batch;
+}
+
+void Velox::beginStaticBatch(Velox::StaticBatch* batch)
+{
+    if (s_recording != nullptr)
+    {
+        LOG_WARN("Already recording, can't begin static batch {}", batch->name);
+        return;
+    }
+
+    Velox::invalidateStaticBatch(batch);
+
+    batch->recording.clear();
+    batch->recording.retained = true;
+    batch->textureGroups.assign(1, TextureGroup {});
+
+    s_recordingBatch = batch;
+    s_recording = &batch->recording;
+}
+
+// Uploads vertices and returns the buffer, 0 if there's nothing to upload.
+static u32 createStaticBuffer(const void* data, size_t size, const std::string& label)
+{
+    if (size == 0)
+        return 0;
+
+    u32 id;
+    glCreateBuffers(1, &id);
+    glNamedBufferStorage(id, size, data, 0);
+    glObjectLabel(GL_BUFFER, id, -1, label.c_str());
+
+    return id;
+}
+
+void Velox::endStaticBatch()
+{
+    Velox::StaticBatch* batch = s_recordingBatch;
+    if (batch == nullptr)
+    {
+        LOG_WARN("endStaticBatch() without beginStaticBatch()");
+        return;
+    }
+
+    s_recordingBatch = nullptr;
+    s_recording = nullptr;
+
+    DrawRecording& recording = batch->recording;
+
+    // Texture groups in draw order, like the frame would assign them.
+    for (Velox::DrawCommand& command : recording.commands)
+    {
+        if (!usesTextureGroup(command))
+            continue;
+
+        const u32 textureSlot = getTextureSlot(&batch->textureGroups, command.texture, &command.textureGroup);
+        command.sortKey = withTextureGroup(command.sortKey, command.textureGroup);
+
+        for (u32 i = 0; i < 4; i++)
+            recording.quadVertices[command.vertexOffset + i].textureSlot = textureSlot;
+    }
+
+    // Same order the frame would draw them in, so same state quads end up next to each other.
+    // Not the frame's sort buffers, the render thread may be using those.
+    std::vector<Velox::SortItem> sortItems;
+    std::vector<Velox::SortItem> sortScratch;
+    for (u32 i = 0; i < recording.commands.size(); i++)
+        sortItems.push_back({ recording.commands[i].sortKey, i });
+
+    Velox::radixSort(&sortItems, &sortScratch);
+
+    std::vector<Velox::TextureVertex> quadVertices;
+    std::vector<Velox::FontVertex>    fontVertices;
+    quadVertices.reserve(recording.quadVertices.size());
+    fontVertices.reserve(recording.fontVertices.size());
+
+    for (const Velox::SortItem& item : sortItems)
+    {
+        const Velox::DrawCommand& command = recording.commands[item.value];
+        const bool font = command.pipeline == &g_fontPipeline;
+
+        const u32 firstVertex = static_cast<u32>(font ? fontVertices.size() : quadVertices.size());
+        if (font)
+        {
+            const Velox::FontVertex* vertices = &recording.fontVertices[command.vertexOffset];
+            fontVertices.insert(fontVertices.end(), vertices, vertices + 4);
+        }
+        else
+        {
+            const Velox::TextureVertex* vertices = &recording.quadVertices[command.vertexOffset];
+            quadVertices.insert(quadVertices.end(), vertices, vertices + 4);
+        }
+
+        if (!batch->draws.empty())
+        {
+            StaticBatchDraw& last = batch->draws.back();
+            if (last.pipeline == command.pipeline && last.shader == command.shader
+                && last.textureGroup == command.textureGroup
+                && (command.textureGroup != UINT32_MAX || last.texture == command.texture))
+            {
+                last.quadCount += 1;
+                continue;
+            }
+        }
+
+        StaticBatchDraw draw {};
+        draw.pipeline     = command.pipeline;
+        draw.shader       = command.shader;
+        draw.texture      = command.texture;
+        draw.textureGroup = command.textureGroup;
+        draw.sortKey      = command.sortKey;
+        draw.firstVertex  = firstVertex;
+        draw.quadCount    = 1;
+        batch->draws.push_back(draw);
+    }
+
+    batch->quadVertexBuffer = createStaticBuffer(quadVertices.data(),
+            sizeof(Velox::TextureVertex) * quadVertices.size(), batch->name + " Static Quad Vertices");
+    batch->fontVertexBuffer = createStaticBuffer(fontVertices.data(),
+            sizeof(Velox::FontVertex) * fontVertices.size(), batch->name + " Static Font Vertices");
+    batch->fontStyleBuffer  = createStaticBuffer(recording.fontStyles.data(),
+            sizeof(Velox::FontStyle) * recording.fontStyles.size(), batch->name + " Static Font Styles");
+
+    // VAOs are made the first time the batch is drawn.
+
+    // Everything needed later is on the GPU or in draws now.
+    recording = {};
+}
+
+void Velox::drawStaticBatch(Velox::StaticBatch* batch, const mat4& transform)
+{
+    if (batch == s_recordingBatch)
+    {
+        LOG_WARN("Can't draw static batch {} while recording it", batch->name);
+        return;
+    }
+
+    if (batch->draws.empty())
+        return;
+
+    // Into a draw list, or the frame. Static batches can't hold each other.
+    DrawRecording* recording = s_recording != nullptr && !s_recording->retained ? s_recording : s_frameRecording;
+    std::vector<mat4>& transforms = recording != nullptr ? recording->staticTransforms : s_staticTransforms;
+
+    const u32 transformIndex = static_cast<u32>(transforms.size());
+    transforms.push_back(transform);
+
+    // Keep the recorded order within the batch, but sort it into the current layer.
+    const u64 layer = static_cast<u64>(s_drawLayer) << 56;
+    const u64 layerMask = 0xFFull << 56;
+
+    for (u32 i = 0; i < batch->draws.size(); i++)
+    {
+        const StaticBatchDraw& draw = batch->draws[i];
+
+        Velox::DrawCommand command {};
+        command.pipeline = draw.pipeline;
+        command.shader   = draw.shader;
+        command.texture  = draw.texture;
+        command.textureGroup = draw.textureGroup;
+        command.sortKey  = s_orderedDrawLayers[s_drawLayer] ? layer : (draw.sortKey & ~layerMask) | layer;
+        command.staticBatch     = batch;
+        command.staticDraw      = i;
+        command.staticTransform = transformIndex;
+
+        if (recording != nullptr)
+        {
+            recording->commands.push_back(command);
+            continue;
+        }
+
+        g_drawCommands.push_back(command);
+
+        s_renderStats.quads += draw.quadCount;
+    }
+}
+
+// VAOs of static batches belong to the render thread's context when there is one.
+static void deleteVertexArray(u32 vao)
+{
+    if (vao == 0)
+        return;
+
+    if (!s_renderThreadRunning)
+    {
+        glDeleteVertexArrays(1, &vao);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_packetMutex);
+    s_deadVertexArrays.push_back(vao);
+}
+
+void Velox::invalidateStaticBatch(Velox::StaticBatch* batch)
+{
+    if (batch == s_recordingBatch)
+    {
+        LOG_WARN("Can't invalidate static batch {} while recording it", batch->name);
+        return;
+    }
+
+    // Frames already handed to the render thread may still draw it.
+    Velox::waitForRenderThread();
+
+    deleteVertexArray(batch->quadVao);
+    deleteVertexArray(batch->fontVao);
+    glDeleteBuffers(1, &batch->quadVertexBuffer);
+    glDeleteBuffers(1, &batch->fontVertexBuffer);
+    glDeleteBuffers(1, &batch->fontStyleBuffer);
+
+    batch->quadVao = 0;
+    batch->fontVao = 0;
+    batch->quadVertexBuffer = 0;
+    batch->fontVertexBuffer = 0;
+    batch->fontStyleBuffer  = 0;
+
+    batch->draws.clear();
+    batch->textureGroups.clear();
+}
+
+void Velox::destroyStaticBatch(Velox::StaticBatch* batch)
+{
+    if (batch == s_recordingBatch)
+    {
+        LOG_WARN("Can't destroy static batch {} while recording it", batch->name);
+        return;
+    }
+
+    Velox::invalidateStaticBatch(batch);
+    delete batch;
+}
+
+bool Velox::isStaticBatchValid(const Velox::StaticBatch* batch)
+{
+    return !batch->draws.empty();
+}
+
+Velox::DrawList* Velox::createDrawList(const char* name)
+{
+    Velox::DrawList* list = new Velox::DrawList();
+    list->name = name;
+
+    return list;
+}
+
+void Velox::destroyDrawList(Velox::DrawList* list)
+{
+    if (list == s_recordingList)
+    {
+        LOG_WARN("Can't destroy draw list {} while recording it", list->name);
+        return;
+    }
+
+    delete list;
+}
+
+void Velox::beginDrawList(Velox::DrawList* list)
+{
+    if (s_recording != nullptr)
+    {
+        LOG_WARN("Already recording, can't begin draw list {}", list->name);
+        return;
+    }
+
+    list->recording.clear();
+
+    list->savedDrawLayer = s_drawLayer;
+    s_drawLayer = Velox::DRAW_LAYER_DEFAULT;
+
+    s_recordingList = list;
+    s_recording = &list->recording;
+}
+
+void Velox::endDrawList()
+{
+    if (s_recordingList == nullptr)
+    {
+        LOG_WARN("endDrawList() without beginDrawList()");
+        return;
+    }
+
+    s_drawLayer = s_recordingList->savedDrawLayer;
+
+    s_recordingList = nullptr;
+    s_recording = nullptr;
+}
+
+u32 Velox::getDrawListSize(const Velox::DrawList* list)
+{
+    return static_cast<u32>(list->recording.commands.size());
+}
+
+// Writes a recorded draw into the frame the same way its draw function would have. Flushes
+// happen at the same points and texture slots and font styles are handed out in the same order,
+// so the frame ends up byte for byte the same.
+static void replayCommand(const DrawRecording& recording, Velox::DrawCommand command)
+{
+    if (command.pipeline == &g_texturedQuadPipeline)
+    {
+        reserve(&g_texturedQuadPipeline, 4, 6);
+
+        u32 textureSlot = 0;
+        if (usesTextureGroup(command))
+        {
+            textureSlot = getTextureSlot(&s_textureGroups, command.texture, &command.textureGroup);
+            command.sortKey = withTextureGroup(command.sortKey, command.textureGroup);
+        }
+
+        const Velox::TextureVertex* source = &recording.quadVertices[command.vertexOffset];
+        command.vertexOffset = g_texturedQuadPipeline.vertexCount;
+
+        // Mapped GPU memory, only ever write to these.
+        Velox::TextureVertex* vertices = g_texturedQuadPipeline.vertices() + command.vertexOffset;
+        for (u32 i = 0; i < 4; i++)
+        {
+            Velox::TextureVertex vertex = source[i];
+            vertex.textureSlot = textureSlot;
+            vertices[i] = vertex;
+        }
+
+        g_texturedQuadPipeline.vertexCount += 4;
+        g_texturedQuadPipeline.indexCount  += 6;
+        s_renderStats.quads += 1;
+    }
+    else if (command.pipeline == &g_fontPipeline)
+    {
+        reserve(&g_fontPipeline, 4, 6);
+
+        const Velox::FontVertex* source = &recording.fontVertices[command.vertexOffset];
+        const u32 styleIndex = writeFontStyle(recording.fontStyles[source[0].style]);
+
+        command.vertexOffset = g_fontPipeline.vertexCount;
+
+        Velox::FontVertex* vertices = g_fontPipeline.vertices() + command.vertexOffset;
+        for (u32 i = 0; i < 4; i++)
+        {
+            Velox::FontVertex vertex = source[i];
+            vertex.style = styleIndex;
+            vertices[i] = vertex;
+        }
+
+        g_fontPipeline.vertexCount += 4;
+        g_fontPipeline.indexCount  += 6;
+        s_renderStats.quads += 1;
     }
+    else if (command.pipeline == &g_linePipeline)
+    {
+        reserve(&g_linePipeline, 2, 2);
 
-    SDL_GL_MakeCurrent(g_window, g_glContext);
+        const Velox::LineVertex* source = &recording.lineVertices[command.vertexOffset];
+        command.vertexOffset = g_linePipeline.vertexCount;
 
-    setVsyncMode(s_vsyncMode);
+        g_linePipeline.vertices()[command.vertexOffset + 0] = source[0];
+        g_linePipeline.vertices()[command.vertexOffset + 1] = source[1];
 
-    SDL_SetWindowPosition(g_window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-    SDL_ShowWindow(g_window);
+        g_linePipeline.vertexCount += 2;
+        g_linePipeline.indexCount  += 2;
+    }
+    else if (command.pipeline == &g_spritePipeline)
+    {
+        reserve(&g_spritePipeline, 1, 1);
 
-    int version = gladLoadGL((GLADloadfunc) SDL_GL_GetProcAddress);
-    LOG_TRACE("Using GL Version {}", (const char*)glGetString(GL_VERSION));
-    LOG_TRACE("GLAD loaded fns for version {}.{}", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+        Velox::SpriteInstance instance = recording.sprites[command.vertexOffset];
+        command.vertexOffset = g_spritePipeline.vertexCount;
 
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        instance.textureSlot = getTextureSlot(&s_textureGroups, command.texture, &command.textureGroup);
+        command.sortKey = withTextureGroup(command.sortKey, command.textureGroup);
 
-    SDL_GetWindowSizeInPixels(g_window, &s_frameBufferSize.x, &s_frameBufferSize.y);
-    glViewport(0, 0, s_frameBufferSize.x, s_frameBufferSize.y);
+        g_spritePipeline.instances()[command.vertexOffset] = instance;
 
-    // Render settings
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
+        g_spritePipeline.vertexCount += 1;
+        g_spritePipeline.indexCount  += 1;
+        s_renderStats.quads += 1;
+    }
 
-    // glEnable(GL_CULL_FACE); 
-    // glCullFace(GL_BACK);
-    // glFrontFace(GL_CW); // Vertices are defind clockwise. This is standard in mordern model formats.
+    pushDrawCommand(command);
+}
 
-    g_texturedQuadPipeline.init(1);
-    g_linePipeline.init(2);
-    g_fontPipeline.init(3);
+static void replayRecording(const DrawRecording& recording, u32 begin, u32 end)
+{
+    // drawStaticBatch() pushes one transform for all of a batch's draws.
+    u32 lastTransform = UINT32_MAX;
 
-    // Uniform buffer
-    glGenBuffers(1, &g_uniformBufferObject);
-    glBindBuffer(GL_UNIFORM_BUFFER, g_uniformBufferObject);
+    for (u32 i = begin; i < end; i++)
+    {
+        Velox::DrawCommand command = recording.commands[i];
 
-    // Allocate memory for UBO struct.
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(Velox::UniformBufferObject), nullptr, GL_DYNAMIC_DRAW);
+        if (command.staticBatch != nullptr)
+        {
+            if (command.staticTransform != lastTransform)
+            {
+                lastTransform = command.staticTransform;
+                s_staticTransforms.push_back(recording.staticTransforms[lastTransform]);
+            }
 
-    // Bind UBO to binding point 0
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, g_uniformBufferObject);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glObjectLabel(GL_BUFFER, g_uniformBufferObject, -1, "Uniform Buffer");
+            command.staticTransform = static_cast<u32>(s_staticTransforms.size()) - 1;
+            g_drawCommands.push_back(command);
 
-    // Load default assets
-    Velox::AssetManager* assetManager = Velox::getAssetManager();
+            s_renderStats.quads += command.staticBatch->draws[command.staticDraw].quadCount;
+            continue;
+        }
 
-    g_defaultShaderProgram = assetManager->loadShaderProgram(
-        "shaders\\textured_quad.vert.glsl",
-        "shaders\\textured_quad.frag.glsl",
-        DEFAULT_SHADER_NAME);
+        replayCommand(recording, command);
+    }
+}
 
-    g_fontShaderProgram = assetManager->loadShaderProgram(
-        "shaders\\sdf_quad.vert.glsl",
-        "shaders\\sdf_quad.frag.glsl",
-        "sdf_quad");
+// Copies recorded draws onto the end of another recording, as if they had been drawn into it.
+static void appendRecording(DrawRecording* to, const DrawRecording& from, u32 begin, u32 end)
+{
+    u32 lastTransform = UINT32_MAX;
 
-    g_colorShaderProgram = assetManager->loadShaderProgram(
-        "shaders\\colored.vert.glsl",
-        "shaders\\colored.frag.glsl",
-        "color");
+    for (u32 i = begin; i < end; i++)
+    {
+        Velox::DrawCommand command = from.commands[i];
 
-    g_errorTexture = assetManager->loadTexture("missing_texture.png");
-    g_whiteTexture = assetManager->loadTexture("white.png");
+        if (command.staticBatch != nullptr)
+        {
+            if (command.staticTransform != lastTransform)
+            {
+                lastTransform = command.staticTransform;
+                to->staticTransforms.push_back(from.staticTransforms[lastTransform]);
+            }
 
-    g_projection =  glm::ortho(0.0f, (float)s_windowSize.x, (float)s_windowSize.y, 0.0f, -1.0f, 1.0f);
-    g_view = glm::mat4(1.0f);
-    // g_view = glm::translate(g_view, glm::vec3(0.0f, 0.0f, -3.0f)); 
-    
-    Velox::SubscribeInfo subInfo {
-        .name = "Renderer",
-        .eventRangeStart = SDL_EVENT_DISPLAY_FIRST,
-        .eventRangeEnd   = SDL_EVENT_WINDOW_LAST,  // Window events are just after display events.
-        .callback = Velox::rendererEventCallback,
-        .priority = 2,
-    };
+            command.staticTransform = static_cast<u32>(to->staticTransforms.size()) - 1;
+        }
+        else if (command.pipeline == &g_texturedQuadPipeline)
+        {
+            const Velox::TextureVertex* source = &from.quadVertices[command.vertexOffset];
+            command.vertexOffset = static_cast<u32>(to->quadVertices.size());
+            to->quadVertices.insert(to->quadVertices.end(), source, source + 4);
+        }
+        else if (command.pipeline == &g_fontPipeline)
+        {
+            const Velox::FontVertex* source = &from.fontVertices[command.vertexOffset];
 
-    Velox::getEventPublisher()->subscribe(subInfo);
+            // Same as drawText(), only a style that differs from the last one is added.
+            const Velox::FontStyle& style = from.fontStyles[source[0].style];
+            std::vector<Velox::FontStyle>& styles = to->fontStyles;
+            if (styles.empty() || SDL_memcmp(&styles.back(), &style, sizeof(style)) != 0)
+                styles.push_back(style);
 
-    checkGLError();
+            command.vertexOffset = static_cast<u32>(to->fontVertices.size());
+            for (u32 v = 0; v < 4; v++)
+            {
+                Velox::FontVertex vertex = source[v];
+                vertex.style = static_cast<u32>(styles.size()) - 1;
+                to->fontVertices.push_back(vertex);
+            }
+        }
+        else if (command.pipeline == &g_linePipeline)
+        {
+            const Velox::LineVertex* source = &from.lineVertices[command.vertexOffset];
+            command.vertexOffset = static_cast<u32>(to->lineVertices.size());
+            to->lineVertices.insert(to->lineVertices.end(), source, source + 2);
+        }
+        else if (command.pipeline == &g_spritePipeline)
+        {
+            const Velox::SpriteInstance& instance = from.sprites[command.vertexOffset];
+            command.vertexOffset = static_cast<u32>(to->sprites.size());
+            to->sprites.push_back(instance);
+        }
+
+        to->commands.push_back(command);
+    }
 }
 
-bool Velox::rendererEventCallback(SDL_Event& event)
+void Velox::submitDrawList(Velox::DrawList* list, u32 begin, u32 end)
 {
-    return false;
+    if (list == s_recordingList || s_recording != nullptr)
+    {
+        LOG_WARN("Can't submit draw list {} while recording", list->name);
+        return;
+    }
+
+    const DrawRecording& recording = list->recording;
+    end = std::min(end, static_cast<u32>(recording.commands.size()));
+
+    // The list is the caller's again next frame, the frame packet gets a copy.
+    if (s_frameRecording != nullptr)
+    {
+        appendRecording(s_frameRecording, recording, begin, end);
+        return;
+    }
+
+    replayRecording(recording, begin, end);
 }
 
-void Velox::drawFrame()
+static void renderFramePacket(FramePacket* packet)
 {
+    if (packet->resourceFence != nullptr)
+    {
+        glWaitSync(packet->resourceFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(packet->resourceFence);
+        packet->resourceFence = nullptr;
+    }
 
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    s_submitView = packet->view;
+    s_submitImGuiDrawData = nullptr;
+    s_submitImGuiTexture  = packet->imguiDrawn ? packet->imguiTexture : 0;
+    s_submitImGuiSize     = packet->imguiSize;
+
+    const DrawRecording& recording = packet->recording;
+    replayRecording(recording, 0, static_cast<u32>(recording.commands.size()));
+
+    presentFrame();
 }
 
-void Velox::submitFrameData()
+static void renderThreadLoop(i32 vsyncMode)
 {
-    // GM: For now we just insert engine stuff here.
-    // Mosly just drawing engine UI elements.
-    Velox::doFrameEndUpdates();
+    SDL_GL_MakeCurrent(g_window, g_glContext);
+    SDL_GL_SetSwapInterval(vsyncMode);
 
-    // Generate ImGui stuff.
-    ImGui::Render();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Copy our vertex data to GPU.
-    Velox::doCopyPass();
+    std::vector<u32> deadVertexArrays;
 
-    // Draw out stuff.
-    Velox::doRenderPass();
+    while (true)
+    {
+        FramePacket* packet;
+        {
+            std::unique_lock<std::mutex> lock(s_packetMutex);
+            s_packetCondition.wait(lock, [] { return !s_queuedPackets.empty() || s_stopRenderThread; });
 
-    SDL_GL_SwapWindow(g_window);
+            // Only stops once everything queued has been drawn.
+            if (s_queuedPackets.empty())
+                break;
 
-    // Reset render frame state.
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplSDL3_NewFrame();
-    ImGui::NewFrame();
+            packet = s_queuedPackets.front();
+            s_queuedPackets.pop_front();
 
-    g_texturedQuadPipeline.clearFrameData();
-    g_linePipeline.clearFrameData();
-    g_fontPipeline.clearFrameData();
-}
+            deadVertexArrays.swap(s_deadVertexArrays);
+        }
 
-void Velox::doCopyPass()
-{
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Copy Pass");
+        if (!deadVertexArrays.empty())
+        {
+            glDeleteVertexArrays(static_cast<GLsizei>(deadVertexArrays.size()), deadVertexArrays.data());
+            deadVertexArrays.clear();
+        }
+
+        if (packet->vsyncMode != vsyncMode)
+        {
+            vsyncMode = packet->vsyncMode;
+            SDL_GL_SetSwapInterval(vsyncMode);
+        }
 
-    g_texturedQuadPipeline.copyData();
-    g_linePipeline.copyData();
-    g_fontPipeline.copyData();
+        renderFramePacket(packet);
 
-    // Uniform
-    UniformBufferObject ubo {};
-    ubo.projection = g_projection;
-    ubo.view = g_view;
-    SDL_GetWindowSize(g_window, &ubo.resolution.x, &ubo.resolution.y);
+        {
+            std::lock_guard<std::mutex> lock(s_packetMutex);
+            s_renderThreadStats = s_renderStats;
+            s_freePackets.push_back(packet);
+            s_packetsInFlight -= 1;
+        }
+        s_packetCondition.notify_all();
 
-    glBindBuffer(GL_UNIFORM_BUFFER, g_uniformBufferObject);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UniformBufferObject), &ubo);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        s_renderStats = {};
+    }
 
-    glPopDebugGroup();
+    SDL_GL_MakeCurrent(g_window, nullptr);
 }
 
-void Velox::doRenderPass()
+// Draws this frame's ImGui into the packet's texture on the main thread's context, premultiplied.
+// The packet isn't in flight, so its texture can be replaced.
+static void renderImGuiToPacket(FramePacket* packet)
 {
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Velox render Pass");
+    ImDrawData* drawData = ImGui::GetDrawData();
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Same size the backend draws at.
+    const ivec2 size = ivec2(
+        static_cast<i32>(drawData->DisplaySize.x * drawData->FramebufferScale.x),
+        static_cast<i32>(drawData->DisplaySize.y * drawData->FramebufferScale.y));
 
-    if (g_drawCommands.size() <= 0)
-    {
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(g_window);
+    // Minimized.
+    packet->imguiDrawn = size.x > 0 && size.y > 0;
+    if (!packet->imguiDrawn)
         return;
+
+    if (packet->imguiFramebuffer == 0)
+        glGenFramebuffers(1, &packet->imguiFramebuffer);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, packet->imguiFramebuffer);
+
+    if (size != packet->imguiSize)
+    {
+        if (packet->imguiTexture != 0)
+            glDeleteTextures(1, &packet->imguiTexture);
+
+        glGenTextures(1, &packet->imguiTexture);
+        glBindTexture(GL_TEXTURE_2D, packet->imguiTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, size.x, size.y);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glObjectLabel(GL_TEXTURE, packet->imguiTexture, -1, "ImGui Frame");
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, packet->imguiTexture, 0);
+        packet->imguiSize = size;
     }
 
-    Velox::DrawCommand& firstCommand = g_drawCommands[0];
+    const f32 transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, transparent);
 
-    Velox::Pipeline* currentPipeline = firstCommand.pipeline;
-    currentPipeline->use(g_uniformBufferObject);
+    // Blends alpha with one/one minus source alpha, leaving color premultiplied.
+    ImGui_ImplOpenGL3_RenderDrawData(drawData);
 
-    u32 currentShaderID  = firstCommand.shader->id;
-    firstCommand.shader->use();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    u32 currentTextureID = firstCommand.texture->id;
-    firstCommand.texture->use();
+    // Bound behind the cache's back.
+    Velox::getGLState()->invalidate();
+}
+
+// Draws the texture renderImGuiToPacket() made over the whole window. On the render thread.
+static void compositeImGui()
+{
+    // Of g_glContext, VAOs aren't shared. Core profile wants one bound even without attributes.
+    static u32 s_compositeVao = 0;
+    if (s_compositeVao == 0)
+        glGenVertexArrays(1, &s_compositeVao);
+
+    Velox::GLStateCache* glState = Velox::getGLState();
+    glState->setViewport(0, 0, s_submitImGuiSize.x, s_submitImGuiSize.y);
+    glState->setBlend(true, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glState->bindVertexArray(s_compositeVao);
+    glState->bindTexture(0, s_submitImGuiTexture);
+    s_compositeShaderProgram->use();
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    s_renderStats.drawCalls += 1;
+
+    glState->setBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState->bindTexture(0, 0);
+    glState->useProgram(0);
+}
 
-    u32 batchOffset = 0;
-    u32 batchIndexCount = 0;
+static void startRenderThread()
+{
+    // g_glContext goes to the render thread along with the VAOs made on it so far. Has to be
+    // current to be shared with, and the new context is made current here.
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    s_resourceContext = SDL_GL_CreateContext(g_window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
 
-    for (int i = 0; i < g_drawCommands.size(); i++)
+    if (s_resourceContext == nullptr)
     {
-        Velox::DrawCommand& command = g_drawCommands[i];
+        LOG_ERROR("Failed to create resource GL context, rendering on the main thread: {}", SDL_GetError());
+        SDL_GL_MakeCurrent(g_window, g_glContext);
+        return;
+    }
 
-        // int textureIdx = static_cast<int>(command.texture.id);
-        // int shaderIdx = static_cast<int>(command.shader.id);
+    const u32 framesInFlight = static_cast<u32>(glm::clamp(s_config->framesInFlight, 1, static_cast<i32>(Velox::MAX_FRAMES_IN_FLIGHT)));
 
-        if (command.pipeline->id != currentPipeline->id || 
-            command.shader->id   != currentShaderID     ||
-            command.texture->id  != currentTextureID)
-        {
-            if (currentShaderID  <= 0) g_defaultShaderProgram->use();
-            if (currentTextureID <= 0) g_errorTexture->use();
+    // One more than can be in flight, for the main thread to record into.
+    for (u32 i = 0; i < framesInFlight + 1; i++)
+    {
+        s_framePackets.push_back(std::make_unique<FramePacket>());
+        s_freePackets.push_back(s_framePackets.back().get());
+    }
 
-            // Submit batch of draws.
-            glDrawElements(currentPipeline->GLDrawType, batchIndexCount, GL_UNSIGNED_INT, (void*)(uintptr_t)batchOffset);
+    s_recordingPacket = s_freePackets.back();
+    s_freePackets.pop_back();
+    s_frameRecording = &s_recordingPacket->recording;
 
-            // update pipeline progress.
-            // pipelineOffsets[currentPipeline->id] += batchIndexCount;
+    s_stopRenderThread = false;
+    s_packetsInFlight = 0;
+    s_renderThreadRunning = true;
 
-            // Reset with new batch.
-            currentPipeline = command.pipeline;
-            currentPipeline->use(g_uniformBufferObject);
+    s_renderThread = std::thread(renderThreadLoop, s_vsyncMode);
 
-            currentShaderID = command.shader->id;
-            command.shader->use();
+    LOG_INFO("Render thread started with {} frames in flight", framesInFlight);
+}
 
-            currentTextureID = command.texture->id;
-            command.texture->use();
+// Hands the frame recorded so far to the render thread and starts recording the next one,
+// waiting if framesInFlight frames are already queued or being drawn.
+static void queueFramePacket()
+{
+    FramePacket* packet = s_recordingPacket;
 
-            batchOffset = command.indexOffset * sizeof(u32);
-            batchIndexCount = 0;
+    captureFrameView(&packet->view);
+    renderImGuiToPacket(packet);
+    packet->vsyncMode = s_vsyncMode;
 
-        }
-        
-        batchIndexCount += command.numIndices;
-    }
+    packet->resourceFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
 
-    // Render last batch if any left.
-    if (batchIndexCount > 0)
-    {
-        if (currentShaderID  <= 0)  g_defaultShaderProgram->use();
-        if (currentTextureID <= 0) g_errorTexture->use();
+    std::unique_lock<std::mutex> lock(s_packetMutex);
 
-        glDrawElements(currentPipeline->GLDrawType, batchIndexCount, GL_UNSIGNED_INT, (void*)(uintptr_t)batchOffset);
-    }
+    s_queuedPackets.push_back(packet);
+    s_packetsInFlight += 1;
+    s_packetCondition.notify_all();
 
-    g_drawCommands.clear();
+    s_packetCondition.wait(lock, [] { return !s_freePackets.empty(); });
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
+    s_recordingPacket = s_freePackets.back();
+    s_freePackets.pop_back();
 
-    glPopDebugGroup();
+    s_lastRenderStats = s_renderThreadStats;
 
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "ImGui");
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    glPopDebugGroup();
+    lock.unlock();
+
+    s_recordingPacket->recording.clear();
+    s_frameRecording = &s_recordingPacket->recording;
 }
 
-void Velox::deInitRenderer()
+void Velox::waitForRenderThread()
 {
-    g_texturedQuadPipeline.deInit();
-    g_linePipeline.deInit();
-    g_fontPipeline.deInit();
-
-    glDeleteBuffers(1, &g_uniformBufferObject);
-
-    glDeleteProgram(g_defaultShaderProgram->id);
+    if (!s_renderThreadRunning)
+        return;
 
-    SDL_GL_DestroyContext(g_glContext);
-    SDL_DestroyWindow(g_window);
-    SDL_Quit();
+    std::unique_lock<std::mutex> lock(s_packetMutex);
+    s_packetCondition.wait(lock, [] { return s_packetsInFlight == 0; });
 }
 
-void Velox::drawQuad(const mat4& transform, const mat4& uvTransform, const vec4& color,
-        Velox::Texture* texture, Velox::ShaderProgram* shader)
+u32 Velox::getFramesInFlight() { return s_renderThreadRunning ? static_cast<u32>(s_framePackets.size()) - 1 : 0; }
+
+// Draws what's queued, drops the frame being recorded and gives g_glContext back to the main thread.
+static void stopRenderThread()
 {
-    const u32 startVertexOffset = g_texturedQuadPipeline.vertexCount;
-    const u32 startIndexOffset = g_texturedQuadPipeline.indexCount;
+    if (!s_renderThreadRunning)
+        return;
 
-    if (startIndexOffset + 6 > MAX_INDICES)
     {
-        LOG_WARN("TexturedQuadPipeline is full, ignoring");
-        return;
+        std::lock_guard<std::mutex> lock(s_packetMutex);
+        s_stopRenderThread = true;
     }
+    s_packetCondition.notify_all();
+
+    s_renderThread.join();
+    s_renderThreadRunning = false;
+
+    SDL_GL_MakeCurrent(g_window, g_glContext);
+
+    if (!s_deadVertexArrays.empty())
+        glDeleteVertexArrays(static_cast<GLsizei>(s_deadVertexArrays.size()), s_deadVertexArrays.data());
+    s_deadVertexArrays.clear();
+
+    // Framebuffers go with the resource context.
+    for (std::unique_ptr<FramePacket>& packet : s_framePackets)
+    {
+        if (packet->imguiTexture != 0)
+            glDeleteTextures(1, &packet->imguiTexture);
+        if (packet->resourceFence != nullptr)
+            glDeleteSync(packet->resourceFence);
+    }
+
+    s_framePackets.clear();
+    s_freePackets.clear();
+    s_queuedPackets.clear();
+    s_recordingPacket = nullptr;
+    s_frameRecording  = nullptr;
+    s_submitImGuiTexture = 0;
 
+    SDL_GL_DestroyContext(s_resourceContext);
+    s_resourceContext = nullptr;
+}
+
+void Velox::drawQuad(const mat4& transform, const mat4& uvTransform, const vec4& color,
+        Velox::Texture* texture, Velox::ShaderProgram* shader)
+{
     constexpr u32 quadVertexCount = 4;
     constexpr u32 quadIndexCount  = 6;
 
@@ -457,29 +2088,66 @@ void Velox::drawQuad(const mat4& transform, const mat4& uvTransform, const vec4&
     command.pipeline = &g_texturedQuadPipeline;
     command.texture  = texture != nullptr ? texture : g_errorTexture;
     command.shader   = shader  != nullptr ? shader  : g_defaultShaderProgram;
-    command.indexOffset = startIndexOffset;
-    command.numIndices  = quadIndexCount;  // Always 6 for a quad.
+    command.numIndices = quadIndexCount;  // Always 6 for a quad.
+
+    // Custom shaders don't take a static batch's transform, those are always drawn right away.
+    DrawRecording* recording = getRecording();
+    if (recording != nullptr && recording->retained && command.shader != g_defaultShaderProgram)
+        recording = s_frameRecording;
+
+    Velox::TextureVertex* vertices;
+    if (recording != nullptr)
+    {
+        command.vertexOffset = static_cast<u32>(recording->quadVertices.size());
+        recording->quadVertices.resize(command.vertexOffset + quadVertexCount);
+        vertices = recording->quadVertices.data() + command.vertexOffset;
+    }
+    else
+    {
+        reserve(&g_texturedQuadPipeline, quadVertexCount, quadIndexCount);
+
+        command.vertexOffset = g_texturedQuadPipeline.vertexCount;
+
+        // Mapped GPU memory, only ever write to these.
+        vertices = g_texturedQuadPipeline.vertices() + command.vertexOffset;
+    }
+
+    // Custom shaders only know about a single texture. Recorded quads get their slot on replay.
+    u32 textureSlot = 0;
+    if (recording == nullptr && command.shader == g_defaultShaderProgram)
+        textureSlot = getTextureSlot(&s_textureGroups, command.texture, &command.textureGroup);
+
+    const u32 textureKey = command.textureGroup != UINT32_MAX ? command.textureGroup : command.texture->id;
+    command.sortKey = makeSortKey(command.pipeline, command.shader, textureKey, transform[3].z);
+
+    // Only part of the texture for ones in an atlas.
+    const Velox::Rectangle& uvRect = command.texture->uvRect;
+
+    const u32 packedColor = glm::packUnorm4x8(color);
 
     for (u32 i = 0; i < quadVertexCount; i++)
     {
         Velox::TextureVertex vertex {};
         vertex.position = transform * QUAD_VERTEX_POSITIONS[i];
-        vertex.color    = color;
-        vertex.uv       = uvTransform * QUAD_UV_POSITIONS[i];
+        vertex.color    = packedColor;
+        vertex.uv       = glm::packUnorm2x16(vec2(uvTransform * QUAD_UV_POSITIONS[i]) * vec2(uvRect.w, uvRect.h) + vec2(uvRect.x, uvRect.y));
+        vertex.textureSlot = textureSlot;
 
-        g_texturedQuadPipeline.vertices[startVertexOffset + i] = vertex;
+        vertices[i] = vertex;
     }
 
-    for (u32 i = 0; i < quadIndexCount; i++)
+    if (recording != nullptr)
     {
-        g_texturedQuadPipeline.indices[startIndexOffset + i] = 
-            QUAD_VERTEX_INDICES[i] + startVertexOffset;
+        recording->commands.push_back(command);
+        return;
     }
 
     g_texturedQuadPipeline.vertexCount += quadVertexCount;
     g_texturedQuadPipeline.indexCount += quadIndexCount;
 
-    g_drawCommands.push_back(command);
+    s_renderStats.quads += 1;
+
+    pushDrawCommand(command);
 }
 
 void Velox::drawQuad(const vec3& position, const vec2& size, const vec4& color,
@@ -526,41 +2194,107 @@ void Velox::drawQuadUV(const Velox::Rectangle& outRect, const Velox::Rectangle&
     Velox::drawQuad(quadTransform, uvTransform, color, texture, shader);
 }
 
-void Velox::drawLine(const vec3& p0, const vec3& p1, const vec4& color)
+void Velox::drawSprite(const vec3& position, const vec2& size, const vec4& color,
+        f32 rotation, Velox::Texture* texture)
 {
-    const u32 startVertexOffset = g_linePipeline.vertexCount;
-    const u32 startIndexOffset  = g_linePipeline.indexCount;
+    DrawRecording* recording = getRecording();
+
+    // Static batches only hold quad vertices.
+    if (recording != nullptr && recording->retained)
+    {
+        Velox::drawRotatedQuad(position, size, color, rotation, texture);
+        return;
+    }
+
+    Velox::DrawCommand command {};
+    command.pipeline = &g_spritePipeline;
+    command.texture  = texture != nullptr ? texture : g_errorTexture;
+    command.shader   = g_spriteShaderProgram;
+    command.numIndices = 1;
+
+    const Velox::Rectangle& uvRect = command.texture->uvRect;
+
+    Velox::SpriteInstance instance {
+        .position    = vec2(position),
+        .size        = size,
+        .uvRect      = vec4(uvRect.x, uvRect.y, uvRect.w, uvRect.h),
+        .rotation    = rotation,
+        .color       = glm::packUnorm4x8(color),
+        .textureSlot = 0,
+        .depth       = position.z,
+    };
 
-    if (startIndexOffset + 6 > MAX_INDICES)
+    if (recording != nullptr)
     {
-        LOG_WARN("TexturedQuadPipeline is full, ignoring");
+        // Texture group and slot are assigned on replay.
+        command.vertexOffset = static_cast<u32>(recording->sprites.size());
+        command.sortKey = makeSortKey(command.pipeline, command.shader, command.texture->id, position.z);
+
+        recording->sprites.push_back(instance);
+        recording->commands.push_back(command);
         return;
     }
 
+    reserve(&g_spritePipeline, 1, 1);
+
+    const u32 instanceOffset = g_spritePipeline.vertexCount;
+    command.vertexOffset = instanceOffset;
+
+    instance.textureSlot = getTextureSlot(&s_textureGroups, command.texture, &command.textureGroup);
+    command.sortKey = makeSortKey(command.pipeline, command.shader, command.textureGroup, position.z);
+
+    // Mapped GPU memory, only ever write to this.
+    g_spritePipeline.instances()[instanceOffset] = instance;
+
+    g_spritePipeline.vertexCount += 1;
+    g_spritePipeline.indexCount  += 1;
+
+    s_renderStats.quads += 1;
+
+    pushDrawCommand(command);
+}
+
+void Velox::drawLine(const vec3& p0, const vec3& p1, const vec4& color)
+{
     Velox::DrawCommand command {};
     command.pipeline = &g_linePipeline;
     command.texture  = g_whiteTexture;
     command.shader   = g_colorShaderProgram;
-    command.indexOffset = startIndexOffset;
-    command.numIndices  = 2;
+    command.numIndices = 2;
+    command.sortKey = makeSortKey(command.pipeline, command.shader, command.texture->id, p0.z);
 
-    g_linePipeline.vertices[startVertexOffset + 0] = Velox::LineVertex {
-        .position = p0,
-        .color    = color,
-    };
+    const u32 packedColor = glm::packUnorm4x8(color);
 
-    g_linePipeline.vertices[startVertexOffset + 1] = Velox::LineVertex {
-        .position = p1,
-        .color    = color,
+    const Velox::LineVertex vertices[2] = {
+        { .position = p0, .color = packedColor },
+        { .position = p1, .color = packedColor },
     };
 
-    g_linePipeline.indices[startIndexOffset + 0] = startVertexOffset + 0;
-    g_linePipeline.indices[startIndexOffset + 1] = startVertexOffset + 1;
+    // Static batches don't keep lines.
+    DrawRecording* recording = getRecording();
+    if (recording != nullptr && recording->retained)
+        recording = s_frameRecording;
+
+    if (recording != nullptr)
+    {
+        command.vertexOffset = static_cast<u32>(recording->lineVertices.size());
+        recording->lineVertices.insert(recording->lineVertices.end(), vertices, vertices + 2);
+        recording->commands.push_back(command);
+        return;
+    }
+
+    reserve(&g_linePipeline, 2, 2);
+
+    command.vertexOffset = g_linePipeline.vertexCount;
+
+    // Mapped GPU memory, only ever write to these.
+    g_linePipeline.vertices()[command.vertexOffset + 0] = vertices[0];
+    g_linePipeline.vertices()[command.vertexOffset + 1] = vertices[1];
 
     g_linePipeline.vertexCount += 2;
     g_linePipeline.indexCount += 2;
 
-    g_drawCommands.push_back(command);
+    pushDrawCommand(command);
 }
 
 void Velox::drawRect(const Velox::Rectangle& rect, const vec4& color)
@@ -608,6 +2342,15 @@ Velox::TextContinueInfo Velox::drawText(const char* text, const vec3& position,
 
     size_t charCount = SDL_strlen(text);
 
+    Velox::FontStyle fontStyle {};
+    fontStyle.innerColor = style.color;
+    fontStyle.outerColor = style.outlineColor;
+    fontStyle.threshold  = style.fontWeightBias;
+    fontStyle.outBias    = 0.25f;
+    fontStyle.outlineWidthAbsolute = style.outlineWidth;
+    fontStyle.outlineWidthRelative = style.outlineWidth / 4;
+    fontStyle.outlineBlur = style.outlineBlur;
+
     // Info conintue info is given then resume advance positions.
     // Probably not going to work well if fonts are switched between drawText calls.
     if (textContinueInfo != nullptr && charCount > 0)
@@ -714,12 +2457,6 @@ Velox::TextContinueInfo Velox::drawText(const char* text, const vec3& position,
 
         // Draw. 
 
-        u32 startVertexOffset = g_fontPipeline.vertexCount;
-        u32 startIndexOffset  = g_fontPipeline.indexCount;
-
-        if (startIndexOffset + 6 > MAX_INDICES)
-            throw std::runtime_error("Font pipeline is full");
-
         constexpr u32 quadVertexCount = 4;
         constexpr u32 quadIndexCount  = 6;
 
@@ -727,30 +2464,50 @@ Velox::TextContinueInfo Velox::drawText(const char* text, const vec3& position,
         command.pipeline = &g_fontPipeline;
         command.texture  = font->texture;
         command.shader   = g_fontShaderProgram;
-        command.indexOffset = startIndexOffset;
-        command.numIndices  = quadIndexCount;  // Always 6 for a quad.
+        command.numIndices = quadIndexCount;  // Always 6 for a quad.
+        command.sortKey = makeSortKey(command.pipeline, command.shader, command.texture->id, position.z);
+
+        DrawRecording* recording = getRecording();
+
+        u32 styleIndex;
+        Velox::FontVertex* vertices;
+        if (recording != nullptr)
+        {
+            std::vector<Velox::FontStyle>& styles = recording->fontStyles;
+            if (styles.empty() || SDL_memcmp(&styles.back(), &fontStyle, sizeof(fontStyle)) != 0)
+                styles.push_back(fontStyle);
+            styleIndex = static_cast<u32>(styles.size()) - 1;
+
+            command.vertexOffset = static_cast<u32>(recording->fontVertices.size());
+            recording->fontVertices.resize(command.vertexOffset + quadVertexCount);
+            vertices = recording->fontVertices.data() + command.vertexOffset;
+        }
+        else
+        {
+            reserve(&g_fontPipeline, quadVertexCount, quadIndexCount);
+
+            // After reserving, a flush starts a new style buffer segment too.
+            styleIndex = writeFontStyle(fontStyle);
+
+            command.vertexOffset = g_fontPipeline.vertexCount;
+            vertices = g_fontPipeline.vertices() + command.vertexOffset;
+        }
 
         glm::mat4 transform = 
             glm::translate(glm::mat4(1.0f), position) *
             glm::scale(glm::mat4(1.0f), vec3(vec2(style.textSize), 1.0f));
 
         Velox::FontVertex baseVertex = {
-            .innerColor = style.color,
-            .threshold  = style.fontWeightBias,
-            .outBias    = 0.25f,
-            .outerColor = style.outlineColor,
-            .outlineWidthAbsolute = style.outlineWidth,
-            .outlineWidthRelative = style.outlineWidth / 4,
-            .outlineBlur = style.outlineBlur,
+            .style = styleIndex,
         };
 
         baseVertex.position = transform * vec4(quadMin.x, quadMin.y, 0.0f, 1.0f);
-        baseVertex.uv       = { textureCoordMin.x, textureCoordMin.y };
-        g_fontPipeline.vertices[startVertexOffset + 0] = baseVertex;
+        baseVertex.uv       = glm::packUnorm2x16(vec2(textureCoordMin.x, textureCoordMin.y));
+        vertices[0] = baseVertex;
 
         baseVertex.position = transform * vec4(quadMin.x, quadMax.y, 0.0f, 1.0f);
-        baseVertex.uv       = { textureCoordMin.x, textureCoordMax.y };
-        g_fontPipeline.vertices[startVertexOffset + 1] = baseVertex;
+        baseVertex.uv       = glm::packUnorm2x16(vec2(textureCoordMin.x, textureCoordMax.y));
+        vertices[1] = baseVertex;
         
         if (drawDebugLines)
         {
@@ -762,12 +2519,12 @@ Velox::TextContinueInfo Velox::drawText(const char* text, const vec3& position,
         }
 
         baseVertex.position = transform * vec4(quadMax.x, quadMax.y, 0.0f, 1.0f);
-        baseVertex.uv       = { textureCoordMax.x, textureCoordMax.y };
-        g_fontPipeline.vertices[startVertexOffset + 2] = baseVertex;
+        baseVertex.uv       = glm::packUnorm2x16(vec2(textureCoordMax.x, textureCoordMax.y));
+        vertices[2] = baseVertex;
 
         baseVertex.position = transform * vec4(quadMax.x, quadMin.y, 0.0f, 1.0f);
-        baseVertex.uv       = { textureCoordMax.x, textureCoordMin.y };
-        g_fontPipeline.vertices[startVertexOffset + 3] = baseVertex;
+        baseVertex.uv       = glm::packUnorm2x16(vec2(textureCoordMax.x, textureCoordMin.y));
+        vertices[3] = baseVertex;
 
         if (drawDebugLines)
         {
@@ -778,16 +2535,19 @@ Velox::TextContinueInfo Velox::drawText(const char* text, const vec3& position,
                 bounds.h = baseVertex.position.y - bounds.y;
         }
 
-        for (u32 i = 0; i < quadIndexCount; i++)
+        if (recording != nullptr)
         {
-            g_fontPipeline.indices[startIndexOffset + i] = 
-                QUAD_VERTEX_INDICES[i] + startVertexOffset;
+            recording->commands.push_back(command);
         }
+        else
+        {
+            g_fontPipeline.vertexCount += quadVertexCount;
+            g_fontPipeline.indexCount  += quadIndexCount;
 
-        g_fontPipeline.vertexCount += quadVertexCount;
-        g_fontPipeline.indexCount  += quadIndexCount;
+            s_renderStats.quads += 1;
 
-        g_drawCommands.push_back(command);
+            pushDrawCommand(command);
+        }
 
         // update advance.
 
@@ -9,6 +9,7 @@
 
 static i64 s_currentFrameTime = 0;
 static i64 s_currentDeltaTime = 0;
+static i64 s_measuredFrameTime = 0; // Before clamping, snapping and averaging.
 
 static bool s_resync = true;
 
@@ -36,12 +37,14 @@ static i64 s_previousFrameTime;
 static i64 s_frameAccumulator;
 
 f64 Velox::getDeltaTime() { return s_fixedDeltaTime; }
+f64 Velox::getFrameTime() { return static_cast<f64>(s_measuredFrameTime) / s_clocksPerSecond; }
 
 void Velox::calculateDeltaTime()
 {
     s_currentFrameTime  = SDL_GetPerformanceCounter();
     s_currentDeltaTime  = s_currentFrameTime - s_previousFrameTime;
     s_previousFrameTime = s_currentFrameTime;
+    s_measuredFrameTime = s_currentDeltaTime;
     
     // Set limit for overflow, long frames, etc.
     s_currentDeltaTime = glm::clamp(s_currentDeltaTime, (i64)0, s_desiredFrameTime * 8);
@@ -661,10 +661,16 @@ void drawBoxRecurseDebug(UI::Box* box)
 
 void UI::drawBoxes()
 {
+    // Above the world. The layer is ordered, so children and text end up on top of their parents.
+    const u8 previousLayer = Velox::getDrawLayer();
+    Velox::setDrawLayer(Velox::DRAW_LAYER_UI);
+
     drawBoxRecurse(s_uiState.root);
 
     if (s_uiState.debug)
         drawBoxRecurseDebug(s_uiState.root);
+
+    Velox::setDrawLayer(previousLayer);
 }
 
 
@@ -721,6 +727,9 @@ void Velox::initUI()
     };
 
     getEventPublisher()->subscribe(subInfo);
+
+    // Boxes are drawn parent first, depth or state sorting would put text under backgrounds.
+    Velox::setDrawLayerOrdered(Velox::DRAW_LAYER_UI, true);
 }
 
 bool Velox::uiEventCallback(SDL_Event& event)
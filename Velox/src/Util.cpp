@@ -63,3 +63,48 @@ bool Velox::isMouseInArea(const Velox::Rectangle& rect)
     return true;
 }
 
+
+void Velox::radixSort(std::vector<Velox::SortItem>* items, std::vector<Velox::SortItem>* scratch)
+{
+    const size_t count = items->size();
+    if (count <= 1)
+        return;
+
+    // All 8 histograms from a single read of the keys.
+    u32 histograms[8][256] = {};
+    for (const Velox::SortItem& item : *items)
+    {
+        for (u32 pass = 0; pass < 8; pass++)
+            histograms[pass][(item.key >> (pass * 8)) & 0xFF] += 1;
+    }
+
+    scratch->resize(count);
+    Velox::SortItem* source      = items->data();
+    Velox::SortItem* destination = scratch->data();
+
+    for (u32 pass = 0; pass < 8; pass++)
+    {
+        const u32 shift = pass * 8;
+        u32* histogram = histograms[pass];
+
+        // Every key has the same byte here, nothing would move.
+        if (histogram[(source[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        u32 offset = 0;
+        for (u32 i = 0; i < 256; i++)
+        {
+            const u32 bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+        std::swap(source, destination);
+    }
+
+    if (source != items->data())
+        items->swap(*scratch);
+}
@@ -0,0 +1,3 @@
+@echo off
+
+.\build\bin\VeloxBenchmarks.exe
@@ -0,0 +1,431 @@
+// Standalone benchmarks, not part of the test suite. Run with bench.cmd
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Collision.h"
+#include "Entity.h"
+#include "Jobs.h"
+#include "Util.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static double secondsSince(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Create/destroy churn on the entity pool. Touches storage and the flattened
+// hierarchy, update callbacks are not involved.
+static void benchEntityChurn(u32 count, u32 rounds)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::EntityHandle> handles;
+    handles.reserve(count);
+
+    double createSeconds  = 0.0;
+    double destroySeconds = 0.0;
+
+    for (u32 round = 0; round < rounds; round++)
+    {
+        handles.clear();
+
+        BenchClock::time_point start = BenchClock::now();
+        for (u32 i = 0; i < count; i++)
+            handles.push_back(manager->createEntity());
+        createSeconds += secondsSince(start);
+
+        start = BenchClock::now();
+        for (u32 i = 0; i < count; i++)
+            manager->destroyEntityInternal(handles[i]);
+        manager->postFrameUpdates(); // Hierarchy cleanup is part of the cost.
+        destroySeconds += secondsSince(start);
+    }
+
+    size_t used, capacity;
+    manager->getMemoryUsage(&used, &capacity);
+
+    const double total = static_cast<double>(count) * rounds;
+
+    printf("entity churn: %u entities x %u rounds\n", count, rounds);
+    printf("  creates/sec:      %.0f\n", total / createSeconds);
+    printf("  destroys/sec:     %.0f\n", total / destroySeconds);
+    printf("  chunks allocated: %u (%u slots)\n", manager->chunkCount, manager->capacity());
+    printf("  bytes/entity:     %zu\n", sizeof(Velox::EntityChunk) / ENTITY_CHUNK_SIZE);
+    printf("  pool bytes:       %zu\n", capacity);
+
+    manager->destroyAllEntities();
+}
+
+// Walks the pool at a given occupancy, both through iter() and the column iteration
+// used by the engine systems. Dead slots are spread evenly so whole words are rarely empty.
+static void benchEntityIteration(u32 slots, u32 occupancyPercent, u32 rounds)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::EntityHandle> handles;
+    handles.reserve(slots);
+    for (u32 i = 0; i < slots; i++)
+        handles.push_back(manager->createEntity());
+
+    u32 alive = slots;
+    for (u32 i = 0; i < slots; i++)
+    {
+        // Keep occupancyPercent of every 100 slots.
+        if ((i % 100) >= occupancyPercent)
+        {
+            manager->destroyEntityInternal(handles[i]);
+            alive -= 1;
+        }
+    }
+    manager->postFrameUpdates();
+
+    size_t visited = 0;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (u32 round = 0; round < rounds; round++)
+    {
+        for (auto [handle, entity] : manager->iter())
+            visited += entity->type + 1;
+    }
+    double iterSeconds = secondsSince(start);
+
+    float sum = 0.0f;
+
+    start = BenchClock::now();
+    for (u32 round = 0; round < rounds; round++)
+    {
+        manager->forEachAbsoluteTransform([&](Velox::EntityHandle, const Velox::EntityTransform& absolute)
+        {
+            sum += absolute.position.x + 1.0f;
+        });
+    }
+    double columnSeconds = secondsSince(start);
+
+    const double totalSlots = static_cast<double>(slots) * rounds;
+
+    printf("entity iteration: %3u%% occupancy (%u / %u alive), %u rounds\n", occupancyPercent, alive, slots, rounds);
+    printf("  iter():            %.2f ns/slot, %.2f ns/entity\n",
+            iterSeconds * 1e9 / totalSlots, iterSeconds * 1e9 / (static_cast<double>(alive) * rounds));
+    printf("  forEachAbsolute:   %.2f ns/slot, %.2f ns/entity\n",
+            columnSeconds * 1e9 / totalSlots, columnSeconds * 1e9 / (static_cast<double>(alive) * rounds));
+    printf("  (checksum %zu %.0f)\n", visited, sum);
+
+    manager->destroyAllEntities();
+}
+
+// Per tick transform propagation with a mostly static scene: groups of a root with
+// children, where only movingPercent of the roots move every tick.
+static void benchEntityTransforms(u32 groups, u32 childrenPerGroup, u32 movingPercent, u32 ticks)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::Entity*> roots;
+    roots.reserve(groups);
+    for (u32 i = 0; i < groups; i++)
+    {
+        Velox::Entity* root = manager->getCreateEntity();
+        root->setFlag(Velox::EntityFlags::Static, (i % 100) >= movingPercent);
+        roots.push_back(root);
+
+        for (u32 c = 0; c < childrenPerGroup; c++)
+            manager->getCreateEntity(root->id)->positionMut() = vec3(static_cast<float>(c), 0.0f, 0.0f);
+    }
+
+    // First update computes everything.
+    manager->updateTransforms();
+
+    size_t recomputed = 0;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (u32 tick = 0; tick < ticks; tick++)
+    {
+        for (Velox::Entity* root : roots)
+        {
+            if (!root->hasFlag(Velox::EntityFlags::Static))
+                root->positionMut().x += 1.0f;
+        }
+
+        manager->updateTransforms();
+        recomputed += manager->transformsRecomputed;
+    }
+    double seconds = secondsSince(start);
+
+    printf("entity transforms: %u groups x %u children, %3u%% moving, %u ticks\n", groups, childrenPerGroup, movingPercent, ticks);
+    printf("  us/tick:            %.2f\n", seconds * 1e6 / ticks);
+    printf("  recomputed/tick:    %zu / %zu\n", recomputed / ticks, manager->aliveCount);
+
+    manager->destroyAllEntities();
+}
+
+// Broadphase with colliders scattered over a 1080p screen. Per tick: gather + build the grid,
+// collect all overlapping pairs, and query once per collider like an update function would.
+static void benchBroadphase(u32 colliders, u32 ticks)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    u32 seed = 1;
+    auto random = [&seed](float range)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * range;
+    };
+
+    std::vector<Velox::Entity*> entities;
+    for (u32 i = 0; i < colliders; i++)
+    {
+        Velox::Entity* entity = manager->getCreateEntity();
+        entity->setFlag(Velox::EntityFlags::Collides, true);
+        entity->positionMut() = vec3(random(1920.0f), random(1080.0f), 0.0f);
+        entity->scaleMut()    = vec2(4.0f + random(12.0f), 4.0f + random(12.0f));
+        entities.push_back(entity);
+    }
+
+    manager->updateTransforms();
+
+    std::vector<std::pair<Velox::EntityHandle, Velox::EntityHandle>> pairs;
+    std::vector<Velox::EntityHandle> overlaps;
+
+    double buildSeconds = 0.0;
+    double pairSeconds  = 0.0;
+    double querySeconds = 0.0;
+    size_t queryHits    = 0;
+
+    for (u32 tick = 0; tick < ticks; tick++)
+    {
+        BenchClock::time_point start = BenchClock::now();
+        manager->updateBroadphase();
+        buildSeconds += secondsSince(start);
+
+        start = BenchClock::now();
+        pairs.clear();
+        manager->getOverlappingPairs(&pairs);
+        pairSeconds += secondsSince(start);
+
+        start = BenchClock::now();
+        for (Velox::Entity* entity : entities)
+        {
+            overlaps.clear();
+            entity->getOverlappingEntities(&overlaps);
+            queryHits += overlaps.size();
+        }
+        querySeconds += secondsSince(start);
+    }
+
+    // Old approach, every collider against every other.
+    BenchClock::time_point start = BenchClock::now();
+    size_t bruteForcePairs = 0;
+    for (u32 a = 0; a < colliders; a++)
+    {
+        for (u32 b = a + 1; b < colliders; b++)
+            bruteForcePairs += Velox::isOverlapping(manager->colliderRects[a], manager->colliderRects[b]);
+    }
+    double bruteForceSeconds = secondsSince(start);
+
+    printf("broadphase: %u colliders, %u ticks, cell size %.1f\n", colliders, ticks, manager->collisionGrid.usedCellSize);
+    printf("  build ms/tick:        %.3f\n", buildSeconds * 1e3 / ticks);
+    printf("  all pairs ms/tick:    %.3f (%zu pairs, brute force %zu)\n", pairSeconds * 1e3 / ticks, pairs.size(), bruteForcePairs);
+    printf("  N queries ms/tick:    %.3f (%zu hits/tick)\n", querySeconds * 1e3 / ticks, queryHits / ticks);
+    printf("  brute force pairs ms: %.3f\n", bruteForceSeconds * 1e3);
+
+    manager->destroyAllEntities();
+}
+
+// One against many and candidate pair narrowphase, for every kernel the CPU supports.
+static void benchOverlapKernels(u32 count, u32 rounds)
+{
+    u32 seed = 3;
+    auto random = [&seed](float range)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * range;
+    };
+
+    std::vector<Velox::Rectangle> rects;
+    for (u32 i = 0; i < count; i++)
+        rects.push_back({ random(1920.0f), random(1080.0f), 4.0f + random(12.0f), 4.0f + random(12.0f) });
+
+    Velox::RectangleBounds bounds;
+    bounds.assign(rects.data(), count);
+
+    // Candidate pairs like a broadphase would produce, mostly nearby rectangles.
+    std::vector<u32> candidateFirst, candidateSecond;
+    for (u32 i = 0; i < count; i++)
+    {
+        for (u32 n = 1; n <= 4; n++)
+        {
+            candidateFirst.push_back(i);
+            candidateSecond.push_back((i + n * 31) % count);
+        }
+    }
+
+    std::vector<u32> hits(count);
+    std::vector<u32> first, second;
+
+    const Velox::OverlapKernel previous = Velox::getOverlapKernel();
+
+    printf("overlap kernels: %u rectangles, %zu candidate pairs\n", count, candidateFirst.size());
+
+    for (u32 kernel = 0; kernel < Velox::OverlapKernel_COUNT; kernel++)
+    {
+        if (!Velox::setOverlapKernel(static_cast<Velox::OverlapKernel>(kernel)))
+            continue;
+
+        size_t hitTotal = 0;
+
+        BenchClock::time_point start = BenchClock::now();
+        for (u32 round = 0; round < rounds; round++)
+            hitTotal += Velox::overlapIndices(rects[round % count], bounds, hits.data());
+        double batchSeconds = secondsSince(start);
+
+        double pairSeconds = 0.0;
+        for (u32 round = 0; round < rounds; round++)
+        {
+            first  = candidateFirst;
+            second = candidateSecond;
+
+            start = BenchClock::now();
+            hitTotal += Velox::overlapPairs(bounds, first.data(), second.data(), static_cast<u32>(first.size()));
+            pairSeconds += secondsSince(start);
+        }
+
+        printf("  %-6s one vs all: %.2f ns/rect, pairs: %.2f ns/pair (checksum %zu)\n",
+                Velox::getOverlapKernelName(static_cast<Velox::OverlapKernel>(kernel)),
+                batchSeconds * 1e9 / (static_cast<double>(count) * rounds),
+                pairSeconds * 1e9 / (static_cast<double>(candidateFirst.size()) * rounds), hitTotal);
+    }
+
+    Velox::setOverlapKernel(previous);
+}
+
+// Synthetic entity update spread over the job system with 1..maxThreads threads (main included).
+// Each update function does a fixed amount of math on its own entity only, so the work is
+// independent and should scale with cores.
+static void benchJobScaling(u32 entities, u32 workPerEntity, u32 maxThreads, u32 ticks)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::Entity*> list;
+    list.reserve(entities);
+    for (u32 i = 0; i < entities; i++)
+    {
+        Velox::Entity* entity = manager->getCreateEntity();
+        entity->positionMut() = vec3(static_cast<float>(i), 0.0f, 0.0f);
+        entity->updateFunction = [workPerEntity](Velox::Entity& self, const double& dt) {
+            vec3& position = self.positionMut();
+            float x = position.x;
+            for (u32 w = 0; w < workPerEntity; w++)
+                x = x * 0.999f + std::sin(x) * static_cast<float>(dt);
+            position.y = x;
+        };
+        list.push_back(entity);
+    }
+
+    printf("job scaling: %u entities, %u work each, %u ticks\n", entities, workPerEntity, ticks);
+
+    double singleThreaded = 0.0;
+    for (u32 threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        Velox::initJobSystem(static_cast<i32>(threads) - 1);
+        Velox::resetJobStats();
+
+        BenchClock::time_point start = BenchClock::now();
+        for (u32 tick = 0; tick < ticks; tick++)
+        {
+            Velox::parallelFor(0, entities, 256, [&list](u32 begin, u32 end) {
+                for (u32 i = begin; i < end; i++)
+                    list[i]->update(1.0 / 60.0);
+            });
+        }
+        double seconds = secondsSince(start);
+
+        if (threads == 1)
+            singleThreaded = seconds;
+
+        u64 stolen = 0;
+        for (u32 t = 0; t < Velox::getJobThreadCount(); t++)
+            stolen += Velox::getJobStats(t).stolen;
+
+        printf("  %2u threads: %8.2f ms/tick  %5.2fx  (%llu jobs stolen)\n", threads, seconds * 1e3 / ticks,
+                singleThreaded / seconds, static_cast<unsigned long long>(stolen));
+
+        Velox::deInitJobSystem();
+    }
+
+    manager->destroyAllEntities();
+}
+
+// Spawning children under existing entities every tick, directly vs through a command buffer.
+// Direct inserts shift the hierarchy once per entity, the buffer does it once per tick.
+static void benchDeferredSpawns(u32 groups, u32 childrenPerGroup, u32 spawnsPerTick, u32 ticks)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+
+    printf("spawning: %u groups x %u children, %u spawns/tick, %u ticks\n", groups, childrenPerGroup, spawnsPerTick, ticks);
+
+    for (u32 deferred = 0; deferred < 2; deferred++)
+    {
+        manager->destroyAllEntities();
+
+        std::vector<Velox::EntityHandle> roots;
+        for (u32 i = 0; i < groups; i++)
+        {
+            roots.push_back(manager->createEntity());
+            for (u32 c = 0; c < childrenPerGroup; c++)
+                manager->createEntity(roots.back());
+        }
+
+        Velox::EntityCommandBuffer& commands = manager->commands();
+
+        u32 next = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (u32 tick = 0; tick < ticks; tick++)
+        {
+            for (u32 i = 0; i < spawnsPerTick; i++)
+            {
+                const Velox::EntityHandle& parent = roots[(next++ * 7919) % groups];
+
+                if (deferred)
+                    commands.createEntity(parent);
+                else
+                    manager->createEntity(parent);
+            }
+
+            manager->postFrameUpdates();
+        }
+        double seconds = secondsSince(start);
+
+        printf("  %s us/tick: %.2f\n", deferred ? "command buffer" : "direct        ", seconds * 1e6 / ticks);
+    }
+
+    manager->destroyAllEntities();
+}
+
+int main()
+{
+    benchEntityChurn(500000, 10);
+
+    benchEntityIteration(ENTITY_CHUNK_SIZE * 64, 10, 100);
+    benchEntityIteration(ENTITY_CHUNK_SIZE * 64, 50, 100);
+    benchEntityIteration(ENTITY_CHUNK_SIZE * 64, 100, 100);
+
+    benchEntityTransforms(10000, 9, 100, 100);
+    benchEntityTransforms(10000, 9, 5, 100);
+    benchEntityTransforms(10000, 9, 0, 100);
+
+    benchDeferredSpawns(1000, 50, 100, 20);
+
+    benchBroadphase(20000, 60);
+
+    benchOverlapKernels(20000, 200);
+
+    benchJobScaling(100000, 64, 16, 20);
+    return 0;
+}
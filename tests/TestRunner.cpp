@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "Arena.h"
+#include "Collision.h"
+#include "Entity.h"
+#include "Jobs.h"
+#include "Rendering/Renderer.h"
+#include "Util.h"
 
 TEST(VeloxTests, arena_construct_small)
 {
@@ -24,7 +31,7 @@ TEST(VeloxTests, arena_alloc_normal)
 {
     Velox::Arena arena(sizeof(int));
     
-    int* aPtr = arena.Alloc<int>(1);
+    int* aPtr = arena.alloc<int>(1);
     
     ASSERT_NE(aPtr, nullptr);
 }
@@ -33,12 +40,562 @@ TEST(VeloxTests, arena_alloc_return_nullptr_when_capacity_exceeded)
 {
     Velox::Arena arena(sizeof(int));
     
-    int* ptrA = arena.Alloc<int>(1);
-    int* ptrB = arena.Alloc<int>(1);
+    int* ptrA = arena.alloc<int>(1);
+    int* ptrB = arena.alloc<int>(1);
     
     ASSERT_EQ(ptrB, nullptr);
 }
 
+TEST(VeloxTests, entity_create_initialises_columns)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* entity = manager->getCreateEntity();
+
+    ASSERT_NE(entity, nullptr);
+    ASSERT_TRUE(entity->hasFlag(Velox::EntityFlags::Updates));
+    ASSERT_EQ(entity->position(), vec3(0.0f));
+    ASSERT_EQ(entity->scale(), vec2(1.0f));
+    ASSERT_EQ(entity->render().texture, nullptr);
+}
+
+TEST(VeloxTests, entity_child_absolute_transform_follows_parent)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* parent = manager->getCreateEntity();
+    Velox::Entity* child  = manager->getCreateEntity(parent->id);
+
+    parent->positionMut() = vec3(100.0f, 50.0f, 0.0f);
+    child->positionMut()  = vec3(10.0f, 0.0f, 0.0f);
+
+    manager->postFrameUpdates();
+
+    double deltaTime = 0.0;
+    manager->updateEntities(deltaTime);
+
+    ASSERT_FLOAT_EQ(child->absolute().position.x, 110.0f);
+    ASSERT_FLOAT_EQ(child->absolute().position.y, 50.0f);
+    ASSERT_FLOAT_EQ(child->collider().x, 110.0f);
+}
+
+TEST(VeloxTests, entity_for_each_collider_skips_non_colliding)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* a = manager->getCreateEntity();
+    Velox::Entity* b = manager->getCreateEntity();
+    a->setFlag(Velox::EntityFlags::Collides, true);
+
+    int visited = 0;
+    manager->forEachCollider([&](Velox::EntityHandle handle, const Velox::Rectangle&)
+    {
+        ASSERT_EQ(handle, a->id);
+        visited += 1;
+    });
+
+    ASSERT_EQ(visited, 1);
+}
+
+TEST(VeloxTests, entity_cull_sprites_uses_rotated_bounds)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* onScreen  = manager->getCreateEntity();
+    Velox::Entity* offScreen = manager->getCreateEntity();
+    Velox::Entity* rotated   = manager->getCreateEntity();
+    Velox::Entity* custom    = manager->getCreateEntity();
+
+    for (Velox::Entity* entity : { onScreen, offScreen, rotated, custom })
+        entity->setFlag(Velox::EntityFlags::Visible, true);
+
+    onScreen->positionMut()  = vec3(10.0f, 10.0f, 0.0f);
+    onScreen->scaleMut()     = vec2(20.0f);
+    offScreen->positionMut() = vec3(200.0f, 10.0f, 0.0f);
+    offScreen->scaleMut()    = vec2(20.0f);
+    // Just right of the view, only reaches into it when turned on its side.
+    rotated->positionMut()   = vec3(102.0f, 40.0f, 0.0f);
+    rotated->scaleMut()      = vec2(4.0f, 40.0f);
+    rotated->rotationMut()   = 90.0f;
+    // Custom draw functions are never culled or counted.
+    custom->positionMut()    = vec3(500.0f, 500.0f, 0.0f);
+    custom->drawFunction  = [](Velox::Entity&) {};
+
+    manager->postFrameUpdates();
+    manager->updateTransforms();
+
+    manager->cullSprites(Velox::Rectangle { 0.0f, 0.0f, 100.0f, 100.0f });
+
+    ASSERT_EQ(manager->spritesSubmitted, 2u);
+    ASSERT_EQ(manager->spritesCulled, 1u);
+    ASSERT_TRUE(manager->isSpriteVisible(0));
+    ASSERT_FALSE(manager->isSpriteVisible(1));
+    ASSERT_TRUE(manager->isSpriteVisible(2));
+}
+
+TEST(VeloxTests, entity_parallel_draws_match_serial)
+{
+    Velox::initJobSystem(3);
+
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    // Layer each entity was drawn on, by index.
+    std::vector<u8> serialLayers(ENTITY_CHUNK_SIZE * 3, 0);
+    std::vector<u8> parallelLayers(ENTITY_CHUNK_SIZE * 3, 0);
+    std::vector<u8>* layers = &serialLayers;
+
+    for (u32 i = 0; i < ENTITY_CHUNK_SIZE * 2 + 1; i++)
+    {
+        Velox::Entity* entity = manager->getCreateEntity();
+        entity->setFlag(Velox::EntityFlags::Visible, true);
+        entity->setFlag(Velox::EntityFlags::ThreadSafeDraw, true);
+        entity->drawFunction = [&layers](Velox::Entity& self) { (*layers)[self.id.index] = Velox::getDrawLayer(); };
+    }
+
+    manager->postFrameUpdates();
+    manager->updateTransforms();
+
+    Velox::setDrawLayer(7);
+
+    manager->parallelDraws = false;
+    manager->drawEntities();
+
+    layers = &parallelLayers;
+    manager->parallelDraws = true;
+    manager->drawEntities();
+
+    ASSERT_EQ(Velox::getDrawLayer(), 7);
+    ASSERT_EQ(serialLayers, parallelLayers);
+    ASSERT_EQ(std::count(parallelLayers.begin(), parallelLayers.end(), 7), ENTITY_CHUNK_SIZE * 2 + 1);
+
+    Velox::setDrawLayer(Velox::DRAW_LAYER_DEFAULT);
+    manager->parallelDraws = false;
+    manager->destroyAllEntities();
+    Velox::deInitJobSystem();
+}
+
+TEST(VeloxTests, entity_pool_grows_past_single_chunk)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::EntityHandle> handles;
+    for (u32 i = 0; i < ENTITY_CHUNK_SIZE * 2 + 1; i++)
+        handles.push_back(manager->createEntity());
+
+    ASSERT_GE(manager->capacity(), ENTITY_CHUNK_SIZE * 3);
+    ASSERT_TRUE(manager->isAlive(handles.back()));
+
+    manager->destroyEntityInternal(handles.back());
+    ASSERT_FALSE(manager->isAlive(handles.back()));
+    ASSERT_TRUE(manager->isAlive(handles.front()));
+}
+
+TEST(VeloxTests, entity_iter_skips_dead_slots)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    std::vector<Velox::EntityHandle> handles;
+    for (u32 i = 0; i < 200; i++)
+        handles.push_back(manager->createEntity());
+
+    // Leaves alive slots on either side of a fully empty 64 slot word.
+    for (u32 i = 1; i < 150; i++)
+        manager->destroyEntityInternal(handles[i]);
+
+    std::vector<Velox::EntityHandle> visited;
+    for (auto [handle, entity] : manager->iter())
+        visited.push_back(handle);
+
+    ASSERT_EQ(visited.size(), 51u);
+    ASSERT_EQ(visited[0], handles[0]);
+    ASSERT_EQ(visited[1], handles[150]);
+    ASSERT_EQ(visited.back(), handles[199]);
+}
+
+TEST(VeloxTests, entity_child_created_before_parent)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* child  = manager->getCreateEntity();
+    Velox::Entity* parent = manager->getCreateEntity();
+
+    child->setParent(parent->id);
+
+    parent->positionMut() = vec3(100.0f, 50.0f, 0.0f);
+    child->positionMut()  = vec3(10.0f, 0.0f, 0.0f);
+
+    manager->updateEntities(0.0);
+
+    std::vector<Velox::EntityHandle> order;
+    manager->getHierarchyHandlesAsVector(&order);
+
+    ASSERT_EQ(order.size(), 2u);
+    ASSERT_EQ(order[0], parent->id);
+    ASSERT_EQ(order[1], child->id);
+    ASSERT_FLOAT_EQ(child->absolute().position.x, 110.0f);
+}
+
+TEST(VeloxTests, entity_destroy_takes_children)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::EntityHandle parent     = manager->createEntity();
+    Velox::EntityHandle child      = manager->createEntity(parent);
+    Velox::EntityHandle grandchild = manager->createEntity(child);
+    Velox::EntityHandle other      = manager->createEntity();
+
+    manager->destroyEntity(child);
+    manager->postFrameUpdates();
+
+    ASSERT_TRUE(manager->isAlive(parent));
+    ASSERT_FALSE(manager->isAlive(child));
+    ASSERT_FALSE(manager->isAlive(grandchild));
+    ASSERT_TRUE(manager->isAlive(other));
+
+    ASSERT_EQ(manager->hierarchy.size(), 2u);
+    ASSERT_EQ(manager->hierarchy[0].subtreeSize, 1u);
+}
+
+TEST(VeloxTests, entity_only_dirty_transforms_recomputed)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::Entity* staticRoot = manager->getCreateEntity();
+    manager->getCreateEntity(staticRoot->id);
+    manager->getCreateEntity(staticRoot->id);
+
+    Velox::Entity* movingRoot  = manager->getCreateEntity();
+    Velox::Entity* movingChild = manager->getCreateEntity(movingRoot->id);
+
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 5u);
+
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 0u);
+
+    movingRoot->positionMut().x = 10.0f;
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 2u);
+    ASSERT_FLOAT_EQ(movingChild->absolute().position.x, 10.0f);
+
+    // Reading doesn't dirty anything.
+    ASSERT_FLOAT_EQ(movingChild->position().x, 0.0f);
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 0u);
+
+    // Static children stay put when their parent moves, until they're moved themselves.
+    movingChild->setFlag(Velox::EntityFlags::Static, 1);
+    movingRoot->positionMut().x = 20.0f;
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 1u);
+    ASSERT_FLOAT_EQ(movingChild->absolute().position.x, 10.0f);
+
+    movingChild->positionMut().y = 5.0f;
+    manager->updateEntities(0.0);
+    ASSERT_EQ(manager->transformsRecomputed, 1u);
+    ASSERT_FLOAT_EQ(movingChild->absolute().position.x, 20.0f);
+}
+
+TEST(VeloxTests, entity_parallel_update_defers_structural_changes)
+{
+    Velox::initJobSystem(3);
+
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+    manager->parallelUpdates = true;
+
+    // Every root replaces its first child with a new one, from inside its update.
+    auto update = [](Velox::Entity& self, const double&) {
+        self.positionMut().x += 1.0f;
+
+        if (self.parent.isValid())
+            return;
+
+        const u32 position = self.manager->hierarchyPositionOf(self.id.index);
+        self.manager->destroyEntity(self.manager->hierarchy[position + 1].handle);
+        self.manager->commands().createEntity(self.id, [](Velox::Entity& child) { child.positionMut().y = 7.0f; });
+    };
+
+    std::vector<Velox::EntityHandle> roots;
+    for (u32 i = 0; i < 65; i++)
+    {
+        Velox::Entity* root = manager->getCreateEntity();
+        root->updateFunction = update;
+        root->setFlag(Velox::EntityFlags::ThreadSafe, i != 64); // Last one runs serially.
+        roots.push_back(root->id);
+
+        for (u32 c = 0; c < 3; c++)
+            manager->getCreateEntity(root->id)->updateFunction = update;
+    }
+
+    manager->updateEntities(0.0);
+
+    // Nothing structural happens until the end of the frame.
+    ASSERT_EQ(manager->hierarchy.size(), 65u * 4u);
+    for (const Velox::EntityHierarchyEntry& entry : manager->hierarchy)
+        ASSERT_FLOAT_EQ(manager->get(entry.handle).position().x, 1.0f);
+
+    manager->postFrameUpdates();
+
+    ASSERT_EQ(manager->hierarchy.size(), 65u * 4u);
+    for (const Velox::EntityHandle& root : roots)
+    {
+        const u32 position = manager->hierarchyPositionOf(root.index);
+        ASSERT_EQ(manager->hierarchy[position].subtreeSize, 4u);
+        ASSERT_FLOAT_EQ(manager->get(manager->hierarchy[position + 3].handle).position().y, 7.0f);
+    }
+
+    manager->parallelUpdates = false;
+    manager->destroyAllEntities();
+    Velox::deInitJobSystem();
+}
+
+TEST(VeloxTests, entity_command_buffer_applies_in_one_batch)
+{
+    Velox::EntityManager* manager = Velox::getEntityManager();
+    manager->destroyAllEntities();
+
+    Velox::EntityHandle parent = manager->createEntity();
+    Velox::EntityHandle first  = manager->createEntity(parent);
+    Velox::EntityHandle other  = manager->createEntity();
+
+    Velox::EntityCommandBuffer buffer;
+    Velox::EntityHandle created = buffer.createEntity(parent);
+    Velox::EntityHandle grandchild = buffer.createEntity(created, [](Velox::Entity& e) { e.positionMut().x = 5.0f; });
+    buffer.setFlag(created, Velox::EntityFlags::Visible, true);
+    buffer.setParent(other, created);
+    buffer.destroyEntity(first);
+
+    // Placeholders only mean something to the buffer.
+    ASSERT_FALSE(manager->isAlive(grandchild));
+
+    manager->applyCommands(&buffer);
+    manager->postFrameUpdates();
+    manager->updateEntities(0.0);
+
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_FALSE(manager->isAlive(first));
+
+    // parent -> created -> (grandchild, other)
+    ASSERT_EQ(manager->hierarchy.size(), 4u);
+    ASSERT_EQ(manager->hierarchy[0].handle, parent);
+    ASSERT_EQ(manager->hierarchy[0].subtreeSize, 4u);
+
+    const Velox::Entity& createdEntity = manager->get(manager->hierarchy[1].handle);
+    ASSERT_EQ(createdEntity.parent, parent);
+    ASSERT_TRUE(createdEntity.hasFlag(Velox::EntityFlags::Visible));
+
+    ASSERT_EQ(manager->get(manager->hierarchy[2].handle).parent, createdEntity.id);
+    ASSERT_FLOAT_EQ(manager->get(manager->hierarchy[2].handle).absolute().position.x, 5.0f);
+    ASSERT_EQ(manager->hierarchy[3].handle, other);
+}
+
+TEST(VeloxTests, collision_grid_matches_brute_force)
+{
+    std::vector<Velox::Rectangle> rects;
+
+    u32 seed = 12345;
+    auto random = [&seed](float range)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * range;
+    };
+
+    for (u32 i = 0; i < 500; i++)
+        rects.push_back({ random(1000.0f) - 500.0f, random(1000.0f) - 500.0f, 1.0f + random(40.0f), 1.0f + random(40.0f) });
+
+    // One huge one to go down the oversized path.
+    rects.push_back({ -400.0f, -400.0f, 800.0f, 800.0f });
+
+    Velox::CollisionGrid grid {};
+    grid.build(rects.data(), static_cast<u32>(rects.size()));
+
+    size_t expectedPairs = 0;
+    for (u32 a = 0; a < rects.size(); a++)
+    {
+        std::vector<u32> hits;
+        grid.query(rects[a], &hits, a);
+        std::sort(hits.begin(), hits.end());
+
+        std::vector<u32> expected;
+        for (u32 b = 0; b < rects.size(); b++)
+        {
+            if (a != b && Velox::isOverlapping(rects[a], rects[b]))
+                expected.push_back(b);
+        }
+
+        ASSERT_EQ(hits, expected);
+        expectedPairs += expected.size();
+    }
+
+    std::vector<std::pair<u32, u32>> pairs;
+    grid.queryPairs(&pairs);
+    std::sort(pairs.begin(), pairs.end());
+
+    ASSERT_EQ(pairs.size(), expectedPairs / 2);
+    ASSERT_TRUE(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end());
+}
+
+TEST(VeloxTests, collision_grid_handles_far_away_rectangles)
+{
+    // Cells out of i32 range get clamped to the edge cell, results still have to match brute force.
+    std::vector<Velox::Rectangle> rects = {
+        { 0.0f,   0.0f, 10.0f, 10.0f },
+        { 1e12f,  0.0f, 10.0f, 10.0f },
+        { 1e12f,  5.0f, 10.0f, 10.0f },
+        { -1e12f, 0.0f, 10.0f, 10.0f },
+    };
+
+    Velox::CollisionGrid grid {};
+    grid.build(rects.data(), static_cast<u32>(rects.size()));
+
+    std::vector<std::pair<u32, u32>> pairs;
+    grid.queryPairs(&pairs);
+
+    std::vector<std::pair<u32, u32>> expected;
+    for (u32 a = 0; a < rects.size(); a++)
+    {
+        for (u32 b = a + 1; b < rects.size(); b++)
+        {
+            if (Velox::isOverlapping(rects[a], rects[b]))
+                expected.emplace_back(a, b);
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    ASSERT_EQ(pairs, expected);
+}
+
+TEST(VeloxTests, overlap_kernels_match_scalar_test)
+{
+    u32 seed = 777;
+    auto random = [&seed](float range)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * range;
+    };
+
+    // Odd count to exercise the scalar tails.
+    std::vector<Velox::Rectangle> rects;
+    for (u32 i = 0; i < 1001; i++)
+        rects.push_back({ random(200.0f), random(200.0f), random(30.0f), random(30.0f) });
+
+    Velox::RectangleBounds bounds;
+    bounds.assign(rects.data(), static_cast<u32>(rects.size()));
+
+    const Velox::OverlapKernel previous = Velox::getOverlapKernel();
+
+    for (u32 kernel = 0; kernel < Velox::OverlapKernel_COUNT; kernel++)
+    {
+        if (!Velox::setOverlapKernel(static_cast<Velox::OverlapKernel>(kernel)))
+            continue;
+
+        for (u32 a = 0; a < 50; a++)
+        {
+            std::vector<u32> hits(rects.size());
+            hits.resize(Velox::overlapIndices(rects[a], bounds, hits.data()));
+
+            std::vector<u32> expected;
+            for (u32 b = 0; b < rects.size(); b++)
+            {
+                if (Velox::isOverlapping(rects[a], rects[b]))
+                    expected.push_back(b);
+            }
+
+            ASSERT_EQ(hits, expected) << Velox::getOverlapKernelName(static_cast<Velox::OverlapKernel>(kernel));
+        }
+
+        std::vector<u32> first, second;
+        std::vector<std::pair<u32, u32>> expected;
+        for (u32 i = 0; i < rects.size(); i++)
+        {
+            const u32 other = (i * 7919) % rects.size();
+            first.push_back(i);
+            second.push_back(other);
+
+            if (Velox::isOverlapping(rects[i], rects[other]))
+                expected.push_back({ i, other });
+        }
+
+        const u32 kept = Velox::overlapPairs(bounds, first.data(), second.data(), static_cast<u32>(first.size()));
+
+        std::vector<std::pair<u32, u32>> keptPairs;
+        for (u32 i = 0; i < kept; i++)
+            keptPairs.push_back({ first[i], second[i] });
+
+        ASSERT_EQ(keptPairs, expected) << Velox::getOverlapKernelName(static_cast<Velox::OverlapKernel>(kernel));
+    }
+
+    Velox::setOverlapKernel(previous);
+}
+
+TEST(VeloxTests, jobs_parallel_for_and_dependencies)
+{
+    Velox::initJobSystem(3);
+
+    std::vector<std::atomic<u32>> visits(10000);
+    Velox::parallelFor(0, 10000, 64, [&visits](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++)
+            visits[i]++;
+    });
+
+    for (u32 i = 0; i < visits.size(); i++)
+        ASSERT_EQ(visits[i].load(), 1u) << i;
+
+    // Second group must only see the first group finished.
+    std::atomic<u32> firstDone { 0 };
+    std::atomic<u32> sawUnfinished { 0 };
+    Velox::JobCounter first;
+    Velox::JobCounter second;
+    for (u32 i = 0; i < 32; i++)
+        Velox::runJob([&firstDone] { firstDone++; }, &first);
+    for (u32 i = 0; i < 32; i++)
+        Velox::runJobAfter(&first, [&firstDone, &sawUnfinished] { if (firstDone != 32) sawUnfinished++; }, &second);
+
+    Velox::waitForCounter(&second);
+    EXPECT_EQ(firstDone.load(), 32u);
+    EXPECT_EQ(sawUnfinished.load(), 0u);
+
+    Velox::deInitJobSystem();
+}
+
+TEST(VeloxTests, radix_sort_is_stable_and_matches_std)
+{
+    std::vector<Velox::SortItem> items;
+    u64 state = 12345;
+    for (u32 i = 0; i < 5000; i++)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        // Few distinct keys spread over the high and low bytes, so stability matters.
+        const u64 key = ((state >> 60) << 56) | ((state >> 33) & 0x7);
+        items.push_back({ key, i });
+    }
+
+    std::vector<Velox::SortItem> expected = items;
+    std::stable_sort(expected.begin(), expected.end(),
+            [](const Velox::SortItem& a, const Velox::SortItem& b) { return a.key < b.key; });
+
+    std::vector<Velox::SortItem> scratch;
+    Velox::radixSort(&items, &scratch);
+
+    ASSERT_EQ(items.size(), expected.size());
+    for (u32 i = 0; i < items.size(); i++)
+    {
+        ASSERT_EQ(items[i].key,   expected[i].key)   << i;
+        ASSERT_EQ(items[i].value, expected[i].value) << i;
+    }
+}
+
 class CustomPrinter : public ::testing::TestEventListener {
 public:
     explicit CustomPrinter(::testing::TestEventListener* wrapped)